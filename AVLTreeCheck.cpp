@@ -0,0 +1,139 @@
+//============================================================================
+// Name        : AVLTreeCheck.cpp
+// Description : Balance check of AVLTree (BinarySearchTree.cpp) on
+//               sorted input, the worst case of the plain tree
+//
+// Bids are inserted in increasing, then decreasing id order. After every
+// doubling the tree height must stay within the AVL bound
+// 1.44 * log2(n + 2), the in-order listing must give every id once in
+// order, and Find must reach every id (and none that was never added).
+// Half the bids are then removed and the same checks run again.
+//
+// Build (BinarySearchTree.cpp is compiled into this program):
+//   g++ -std=c++17 -O2
+//       -I"CS-300 2-3 Assignment/CS 300 Vector Sorting Assignment Student Files"
+//       AVLTreeCheck.cpp -o AVLTreeCheck
+// Usage: AVLTreeCheck [number of bids]
+//============================================================================
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+struct Bid {
+    std::string bidId; // unique identifier
+    std::string title;
+    std::string fund;
+    double amount;
+    Bid() : amount(0.0) {}
+};
+
+#include "BinarySearchTree.cpp"
+
+/* Fixed width ids, so string order is numeric order */
+static string idOf(unsigned int n) {
+    string id = to_string(n);
+    return string(10 - id.size(), '0') + id;
+}
+
+/* Height, listing and lookups of a tree holding exactly the ids in `held` */
+static bool checkTree(AVLTree& tree, const vector<bool>& held, const char* stage) {
+    unsigned int size = 0;
+    for (bool h : held) {
+        size += h;
+    }
+
+    double bound = 1.44 * log2(size + 2.0);
+    if (tree.Size() != size || tree.Height() > bound) {
+        cout << "FAIL (" << stage << "): " << tree.Size() << " bids, height " << tree.Height()
+            << ", expected " << size << " bids within height " << bound << endl;
+        return false;
+    }
+
+    // in-order listing, one csv row per bid, must be every held id in order
+    ostringstream listing;
+    {
+        out::Sink sink(listing, out::Format::Csv);
+        tree.InOrder(sink);
+    }
+    istringstream rows(listing.str());
+    string row;
+    if (size > 0 && (!getline(rows, row) || row.compare(0, 6, "bidId,") != 0)) {
+        cout << "FAIL (" << stage << "): in-order listing starts with \"" << row << "\", not the header" << endl;
+        return false;
+    }
+    unsigned int next = 0;
+    while (getline(rows, row)) {
+        while (next < held.size() && !held[next]) {
+            ++next;
+        }
+        if (next == held.size() || row.compare(0, 11, idOf(next) + ",") != 0) {
+            cout << "FAIL (" << stage << "): in-order listing has \"" << row << "\" out of place" << endl;
+            return false;
+        }
+        ++next;
+    }
+    while (next < held.size() && !held[next]) {
+        ++next;
+    }
+    if (next != held.size()) {
+        cout << "FAIL (" << stage << "): in-order listing misses " << idOf(next) << endl;
+        return false;
+    }
+
+    for (unsigned int n = 0; n < held.size(); ++n) {
+        const Bid* bid = tree.Find(idOf(n));
+        if (held[n] ? bid == nullptr || bid->bidId != idOf(n) : bid != nullptr) {
+            cout << "FAIL (" << stage << "): Find(" << idOf(n) << ") "
+                << (held[n] ? "missed it" : "found a removed bid") << endl;
+            return false;
+        }
+    }
+    cout << stage << ": " << size << " bids, height " << tree.Height()
+        << " (bound " << bound << ")" << endl;
+    return true;
+}
+
+static bool checkSorted(unsigned int count, bool increasing) {
+    const char* order = increasing ? "increasing" : "decreasing";
+    AVLTree tree;
+    vector<bool> held(count, false);
+
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int n = increasing ? i : count - 1 - i;
+        Bid bid;
+        bid.bidId = idOf(n);
+        bid.title = "Bid " + to_string(n);
+        bid.fund = "General Fund";
+        bid.amount = n;
+        tree.Insert(bid);
+        held[n] = true;
+
+        // the full check is linear, so only run it when the size doubles
+        unsigned int size = i + 1;
+        if ((size & (size - 1)) == 0 || size == count) {
+            string stage = string(order) + " insert";
+            if (!checkTree(tree, held, stage.c_str())) {
+                return false;
+            }
+        }
+    }
+
+    for (unsigned int n = 0; n < count; n += 2) {
+        tree.Remove(idOf(n));
+        held[n] = false;
+    }
+    string stage = string(order) + " remove";
+    return checkTree(tree, held, stage.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+
+    if (!checkSorted(count, true) || !checkSorted(count, false)) {
+        return 1;
+    }
+    cout << "ok" << endl;
+    return 0;
+}
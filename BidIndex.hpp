@@ -0,0 +1,304 @@
+#ifndef     _BIDINDEX_HPP_
+# define    _BIDINDEX_HPP_
+
+/*
+    BidIndex.hpp
+    Secondary indexes over bids stored in another container.
+
+    The container keeps owning the bids; the index holds pointers to them:
+        fund   : hash index, fund name -> set of bids
+        amount : ordered index, an AVL tree over (amount, bid) whose nodes
+                 count their subtree, so ranks and range counts by amount
+                 take O(log n) without visiting the bids
+    The owning container calls Add after a bid is stored and Remove before
+    it is destroyed or moved, so the pointers always refer to live bids.
+    Query intersects the two indexes by walking whichever side is smaller,
+    so a report touches only the matching bids.
+
+    Works with any Bid type that has a string fund and a double amount.
+*/
+
+# include <functional>
+# include <string>
+# include <string_view>
+# include <unordered_map>
+# include <unordered_set>
+# include <vector>
+# include "NodePool.hpp"
+
+template<typename Bid>
+class BidIndex {
+private:
+    struct AmountNode {
+        double amount;
+        const Bid* bid;  // breaks ties between equal amounts
+        AmountNode* left;
+        AmountNode* right;
+        int height;      // of the subtree rooted here, a leaf is 1
+        size_t count;    // bids in the subtree rooted here
+
+        AmountNode(double anAmount, const Bid* aBid)
+            : amount(anAmount), bid(aBid), left(nullptr), right(nullptr), height(1), count(1) {}
+    };
+
+    std::unordered_map<std::string, std::unordered_set<const Bid*> > byFund;
+    AmountNode* byAmount;
+    NodePool<AmountNode> amountPool;
+
+    BidIndex(const BidIndex&);
+    BidIndex& operator=(const BidIndex&);
+
+    static int height(const AmountNode* node) {
+        return node == nullptr ? 0 : node->height;
+    }
+
+    static size_t count(const AmountNode* node) {
+        return node == nullptr ? 0 : node->count;
+    }
+
+    static void update(AmountNode* node) {
+        int left = height(node->left);
+        int right = height(node->right);
+        node->height = (left > right ? left : right) + 1;
+        node->count = count(node->left) + count(node->right) + 1;
+    }
+
+    static AmountNode* rotateLeft(AmountNode* node) {
+        AmountNode* pivot = node->right;
+        node->right = pivot->left;
+        pivot->left = node;
+        update(node);
+        update(pivot);
+        return pivot;
+    }
+
+    static AmountNode* rotateRight(AmountNode* node) {
+        AmountNode* pivot = node->left;
+        node->left = pivot->right;
+        pivot->right = node;
+        update(node);
+        update(pivot);
+        return pivot;
+    }
+
+    static AmountNode* balance(AmountNode* node) {
+        update(node);
+        int skew = height(node->left) - height(node->right);
+        if (skew > 1) {
+            if (height(node->left->left) < height(node->left->right)) {
+                node->left = rotateLeft(node->left);
+            }
+            return rotateRight(node);
+        }
+        if (skew < -1) {
+            if (height(node->right->right) < height(node->right->left)) {
+                node->right = rotateRight(node->right);
+            }
+            return rotateLeft(node);
+        }
+        return node;
+    }
+
+    /* (amount, bid) ordering of the tree */
+    static bool before(double amount, const Bid* bid, const AmountNode* node) {
+        if (amount != node->amount) return amount < node->amount;
+        return std::less<const Bid*>()(bid, node->bid);
+    }
+
+    AmountNode* insert(AmountNode* node, const Bid* bid) {
+        if (node == nullptr) {
+            return amountPool.New(bid->amount, bid);
+        }
+        if (before(bid->amount, bid, node)) {
+            node->left = insert(node->left, bid);
+        }
+        else {
+            node->right = insert(node->right, bid);
+        }
+        return balance(node);
+    }
+
+    AmountNode* erase(AmountNode* node, const Bid* bid) {
+        if (node == nullptr) {
+            return node;
+        }
+        if (node->bid == bid) {
+            AmountNode* left = node->left;
+            AmountNode* right = node->right;
+            amountPool.Delete(node);
+            if (right == nullptr) {
+                return left;
+            }
+            AmountNode* successor;
+            right = eraseMin(right, successor);
+            successor->left = left;
+            successor->right = right;
+            return balance(successor);
+        }
+        if (before(bid->amount, bid, node)) {
+            node->left = erase(node->left, bid);
+        }
+        else {
+            node->right = erase(node->right, bid);
+        }
+        return balance(node);
+    }
+
+    static AmountNode* eraseMin(AmountNode* node, AmountNode*& min) {
+        if (node->left == nullptr) {
+            min = node;
+            return node->right;
+        }
+        node->left = eraseMin(node->left, min);
+        return balance(node);
+    }
+
+    /* Bids with amount < limit, or <= limit when `inclusive` */
+    size_t countBelow(double limit, bool inclusive) const {
+        size_t below = 0;
+        const AmountNode* node = byAmount;
+        while (node != nullptr) {
+            if (node->amount < limit || (inclusive && node->amount == limit)) {
+                below += count(node->left) + 1;
+                node = node->right;
+            }
+            else {
+                node = node->left;
+            }
+        }
+        return below;
+    }
+
+    /* Append the bids below node with minAmount <= amount <= maxAmount, in order */
+    static void collect(const AmountNode* node, double minAmount, double maxAmount,
+                        std::vector<const Bid*>& result) {
+        if (node == nullptr) return;
+        if (minAmount <= node->amount) {
+            collect(node->left, minAmount, maxAmount, result);
+        }
+        if (minAmount <= node->amount && node->amount <= maxAmount) {
+            result.push_back(node->bid);
+        }
+        if (node->amount <= maxAmount) {
+            collect(node->right, minAmount, maxAmount, result);
+        }
+    }
+
+public:
+    BidIndex() : byAmount(nullptr) {}
+
+    /* Index a stored bid */
+    void Add(const Bid* bid) {
+        byFund[bid->fund].insert(bid);
+        byAmount = insert(byAmount, bid);
+    }
+
+    /* Forget a bid; must be called while *bid still holds its indexed values */
+    void Remove(const Bid* bid) {
+        auto fund = byFund.find(bid->fund);
+        if (fund != byFund.end()) {
+            fund->second.erase(bid);
+            if (fund->second.empty()) {
+                byFund.erase(fund);
+            }
+        }
+
+        byAmount = erase(byAmount, bid);
+    }
+
+    void Clear() {
+        byFund.clear();
+        amountPool.Clear();
+        byAmount = nullptr;
+    }
+
+    /* Number of bids indexed */
+    size_t Size() const {
+        return count(byAmount);
+    }
+
+    /* All bids of one fund */
+    std::vector<const Bid*> ByFund(std::string_view fund) const {
+        std::vector<const Bid*> result;
+        auto it = byFund.find(std::string(fund));
+        if (it != byFund.end()) {
+            result.assign(it->second.begin(), it->second.end());
+        }
+        return result;
+    }
+
+    /* All bids with minAmount <= amount <= maxAmount, by increasing amount */
+    std::vector<const Bid*> ByAmount(double minAmount, double maxAmount) const {
+        std::vector<const Bid*> result;
+        collect(byAmount, minAmount, maxAmount, result);
+        return result;
+    }
+
+    /* The bid at position k (from 0) by increasing amount; nullptr if k >= Size() */
+    const Bid* SelectAmount(size_t k) const {
+        const AmountNode* node = byAmount;
+        while (node != nullptr) {
+            size_t left = count(node->left);
+            if (k < left) {
+                node = node->left;
+            }
+            else if (k == left) {
+                return node->bid;
+            }
+            else {
+                k -= left + 1;
+                node = node->right;
+            }
+        }
+        return nullptr;
+    }
+
+    /* Number of bids with an amount below `amount` */
+    size_t RankAmount(double amount) const {
+        return countBelow(amount, false);
+    }
+
+    /* Number of bids with minAmount <= amount <= maxAmount */
+    size_t CountAmount(double minAmount, double maxAmount) const {
+        if (minAmount > maxAmount) return 0;
+        return countBelow(maxAmount, true) - countBelow(minAmount, false);
+    }
+
+    /*
+        Bids of `fund` (any fund if empty) with minAmount <= amount <= maxAmount.
+        Both the fund set size and the amount range count are known in
+        O(log n), so only the smaller side is walked.
+    */
+    std::vector<const Bid*> Query(std::string_view fund, double minAmount, double maxAmount) const {
+        if (fund.empty()) {
+            return ByAmount(minAmount, maxAmount);
+        }
+
+        std::vector<const Bid*> result;
+        auto bucket = byFund.find(std::string(fund));
+        if (bucket == byFund.end() || minAmount > maxAmount) {
+            return result;
+        }
+        const std::unordered_set<const Bid*>& funded = bucket->second;
+
+        if (CountAmount(minAmount, maxAmount) > funded.size()) {
+            // the amount range is the bigger side: filter the fund set
+            for (const Bid* bid : funded) {
+                if (bid->amount >= minAmount && bid->amount <= maxAmount) {
+                    result.push_back(bid);
+                }
+            }
+            return result;
+        }
+
+        std::vector<const Bid*> inRange = ByAmount(minAmount, maxAmount);
+        for (const Bid* bid : inRange) {
+            if (bid->fund == fund) {
+                result.push_back(bid);
+            }
+        }
+        return result;
+    }
+};
+
+#endif /*!_BIDINDEX_HPP_*/
@@ -0,0 +1,256 @@
+#ifndef     _BIDSNAPSHOT_HPP_
+# define    _BIDSNAPSHOT_HPP_
+
+/*
+    BidSnapshot.hpp
+    Binary cache of loaded bids so later runs can skip parsing the CSV.
+
+    The snapshot lives next to the CSV as "<csv>.snap" and is laid out as
+        header   : magic, version, source size and mtime, record count,
+                   string pool size, checksum of everything after the header
+        records  : one fixed width record per bid (offset/length of each
+                   string in the pool, amount)
+        pool     : bidId, title and fund bytes back to back
+    It is mapped read-only on load and thrown away (rebuilt on the next
+    load) when the CSV size or modification time no longer matches. The
+    stamp is taken before the CSV is parsed, so a CSV edited during the
+    load leaves a snapshot that is already stale.
+
+    Works with any Bid type that has string bidId, title, fund and a double
+    amount, so each program can keep its own Bid definition.
+*/
+
+# include <cstdint>
+# include <cstdio>
+# include <cstring>
+# include <filesystem>
+# include <fstream>
+# include <string>
+# include <vector>
+# ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+# endif
+
+namespace snapshot
+{
+    static const uint32_t MAGIC = 0x50534942; // "BISP"
+    // bump whenever the layout or the way bids are parsed changes
+    // (2: CRLF line endings stripped, long currency values kept,
+    //  3: CSV quoting removed from bound values)
+    static const uint32_t VERSION = 3;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t  sourceTime;
+        uint64_t count;
+        uint64_t poolSize;
+        uint64_t checksum;
+    };
+
+    struct Record
+    {
+        uint32_t idOffset, idLength;
+        uint32_t titleOffset, titleLength;
+        uint32_t fundOffset, fundLength;
+        double   amount;
+    };
+
+    inline std::string pathFor(const std::string &csvPath)
+    {
+        return csvPath + ".snap";
+    }
+
+    /* FNV-1a over a byte range, chained through hash */
+    inline uint64_t checksum(const char *data, std::size_t len, uint64_t hash = 14695981039346656037ULL)
+    {
+        for (std::size_t i = 0; i < len; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /* size and mtime of the source csv, false if it cannot be read */
+    inline bool sourceStamp(const std::string &csvPath, uint64_t &size, int64_t &time)
+    {
+        std::error_code ec;
+        size = std::filesystem::file_size(csvPath, ec);
+        if (ec) return false;
+        time = std::filesystem::last_write_time(csvPath, ec).time_since_epoch().count();
+        return !ec;
+    }
+
+    /*
+        Collects bids while the CSV is parsed and writes the snapshot with
+        one buffered write on Commit().
+    */
+    class Writer {
+    private:
+        std::string csvPath;
+        bool stamped;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        std::vector<Record> records;
+        std::string pool;
+        bool overflow;  // the pool outgrew the 32 bit offsets, nothing is written
+
+        uint32_t addString(const std::string &s) {
+            if (s.size() > UINT32_MAX - pool.size()) {
+                overflow = true;
+                return 0;
+            }
+            uint32_t offset = static_cast<uint32_t>(pool.size());
+            pool.append(s);
+            return offset;
+        }
+
+    public:
+        explicit Writer(const std::string &path)
+            : csvPath(path), sourceSize(0), sourceTime(0), overflow(false) {
+            stamped = sourceStamp(csvPath, sourceSize, sourceTime);
+        }
+
+        template<typename Bid>
+        void Add(const Bid &bid) {
+            if (!stamped || overflow) return;
+            Record record;
+            record.idOffset = addString(bid.bidId);
+            record.idLength = static_cast<uint32_t>(bid.bidId.size());
+            record.titleOffset = addString(bid.title);
+            record.titleLength = static_cast<uint32_t>(bid.title.size());
+            record.fundOffset = addString(bid.fund);
+            record.fundLength = static_cast<uint32_t>(bid.fund.size());
+            record.amount = bid.amount;
+            records.push_back(record);
+        }
+
+        /* returns false if the snapshot could not be written; loading still works */
+        bool Commit() {
+            if (!stamped || overflow) return false;
+
+            // the CSV changed while it was parsed, the records may mix both versions
+            uint64_t size;
+            int64_t time;
+            if (!sourceStamp(csvPath, size, time) || size != sourceSize || time != sourceTime) return false;
+
+            Header header;
+            std::memset(&header, 0, sizeof(header));
+            header.sourceSize = sourceSize;
+            header.sourceTime = sourceTime;
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.count = records.size();
+            header.poolSize = pool.size();
+            header.checksum = checksum(reinterpret_cast<const char*>(records.data()),
+                                       records.size() * sizeof(Record));
+            header.checksum = checksum(pool.data(), pool.size(), header.checksum);
+
+            // write to a temporary file and rename so readers never see half a snapshot
+            std::string tmpPath = pathFor(csvPath) + ".tmp";
+            std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) return false;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+            out.write(pool.data(), pool.size());
+            out.close();
+            if (!out) {
+                std::remove(tmpPath.c_str());
+                return false;
+            }
+
+            std::error_code ec;
+            std::filesystem::rename(tmpPath, pathFor(csvPath), ec);
+            return !ec;
+        }
+    };
+
+    /*
+        Maps the snapshot for csvPath and calls visit(bid) for every record.
+        Returns false (without calling visit) when there is no snapshot or it
+        is stale or corrupt, in which case the caller parses the CSV.
+    */
+    template<typename Bid, typename Visit>
+    bool Load(const std::string &csvPath, Visit visit) {
+        uint64_t size;
+        int64_t time;
+        if (!sourceStamp(csvPath, size, time)) return false;
+
+        std::string path = pathFor(csvPath);
+        const char* data = nullptr;
+        std::size_t length = 0;
+
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+            close(fd);
+            return false;
+        }
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) return false;
+        data = static_cast<const char*>(map);
+        length = st.st_size;
+#else
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        if (!in.is_open()) return false;
+        std::vector<char> buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        length = buffer.size();
+#endif
+
+        bool ok = false;
+        Header header;
+        if (length >= sizeof(Header)) {
+            std::memcpy(&header, data, sizeof(header));
+            const char* body = data + sizeof(Header);
+            std::size_t bodyLength = length - sizeof(Header);
+
+            ok = header.magic == MAGIC && header.version == VERSION
+                && header.sourceSize == size && header.sourceTime == time
+                && header.count <= bodyLength / sizeof(Record)
+                && header.count * sizeof(Record) + header.poolSize == bodyLength
+                && checksum(body, bodyLength) == header.checksum;
+
+            if (ok) {
+                const char* pool = body + header.count * sizeof(Record);
+                for (uint64_t i = 0; i < header.count; ++i) {
+                    Record record;
+                    std::memcpy(&record, body + i * sizeof(Record), sizeof(record));
+                    if (static_cast<uint64_t>(record.idOffset) + record.idLength > header.poolSize
+                        || static_cast<uint64_t>(record.titleOffset) + record.titleLength > header.poolSize
+                        || static_cast<uint64_t>(record.fundOffset) + record.fundLength > header.poolSize) {
+                        ok = false;
+                        break;
+                    }
+                }
+                if (ok) {
+                    for (uint64_t i = 0; i < header.count; ++i) {
+                        Record record;
+                        std::memcpy(&record, body + i * sizeof(Record), sizeof(record));
+                        Bid bid;
+                        bid.bidId.assign(pool + record.idOffset, record.idLength);
+                        bid.title.assign(pool + record.titleOffset, record.titleLength);
+                        bid.fund.assign(pool + record.fundOffset, record.fundLength);
+                        bid.amount = record.amount;
+                        visit(bid);
+                    }
+                }
+            }
+        }
+
+#ifndef _WIN32
+        munmap(const_cast<char*>(data), length);
+#endif
+        return ok;
+    }
+}
+
+#endif /*!_BIDSNAPSHOT_HPP_*/
@@ -1,86 +1,492 @@
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "BidIndex.hpp"
 #include "CSVparser.hpp"
+#include "NodePool.hpp"
+#include "OutputSink.hpp"
 using namespace std;
 
 /*
     BinarySearchTree.cpp
-    Implementation of a simple binary search tree to store bids by bidId.
+    Implementation of a simple binary search tree to store bids by bidId,
+    of AVLTree, a balanced variant with the same interface, and of
+    PersistentTree, whose immutable versions can be read while it changes.
 */
 
 struct Node {
     Bid bid;
     Node* left;
     Node* right;
+    unsigned int count; // bids in the subtree rooted here
 
     Node() {
         left = nullptr;
         right = nullptr;
+        count = 1;
     }
 
-    Node(Bid aBid) : Node() {
-        this->bid = aBid;
+    Node(Bid aBid) : bid(std::move(aBid)), left(nullptr), right(nullptr), count(1) {}
+};
+
+/* One traversal record; text format is "id: title | amount | fund" */
+static void writeBid(out::Sink& sink, const Bid& bid) {
+    sink.Begin();
+    sink.Field("bidId", bid.bidId);
+    sink.Field("title", bid.title, ": ");
+    sink.Money("amount", bid.amount, " | ");
+    sink.Field("fund", bid.fund, " | ");
+    sink.End();
+}
+
+/* Child links are raw pointers, or shared_ptr in PersistentTree; raw() reads either */
+template<typename TreeNode>
+static const TreeNode* raw(const TreeNode* node) {
+    return node;
+}
+
+template<typename TreeNode>
+static const TreeNode* raw(const shared_ptr<const TreeNode>& node) {
+    return node.get();
+}
+
+/* A node's bid; PersistentTree nodes share theirs between versions, bidOf() reads either */
+template<typename TreeNode>
+static const Bid& bidOf(const TreeNode* node) {
+    return node->bid;
+}
+
+struct PersistentNode;
+static const Bid& bidOf(const PersistentNode* node);
+
+/*
+    In-order cursor shared by the trees. The nodes have no parent links, so
+    the cursor keeps the path of ancestors still to be visited (current
+    node on top): ++ pops it and pushes the left spine of its right
+    subtree. Walking the whole tree costs O(n), a seek O(height), and
+    nothing is recursive or copied. Any Insert or Remove invalidates it.
+*/
+template<typename TreeNode>
+class TreeIterator {
+private:
+    vector<const TreeNode*> path;
+
+    void pushLeft(const TreeNode* node) {
+        while (node != nullptr) {
+            path.push_back(node);
+            node = raw(node->left);
+        }
+    }
+
+public:
+    /* The end iterator */
+    TreeIterator() {}
+
+    /* Smallest bid of the tree */
+    static TreeIterator First(const TreeNode* root) {
+        TreeIterator it;
+        it.pushLeft(root);
+        return it;
     }
+
+    /* First bid with id >= key, or > key when `after` is set */
+    static TreeIterator Seek(const TreeNode* root, string_view key, bool after) {
+        TreeIterator it;
+        const TreeNode* node = root;
+        while (node != nullptr) {
+            int cmp = key.compare(bidOf(node).bidId);
+            if (cmp < 0 || (cmp == 0 && !after)) {
+                // node comes after key: visit it once its left subtree is done
+                it.path.push_back(node);
+                node = raw(node->left);
+            }
+            else {
+                node = raw(node->right);
+            }
+        }
+        return it;
+    }
+
+    const Bid& operator*() const {
+        return bidOf(path.back());
+    }
+
+    const Bid* operator->() const {
+        return &bidOf(path.back());
+    }
+
+    TreeIterator& operator++() {
+        const TreeNode* node = path.back();
+        path.pop_back();
+        pushLeft(raw(node->right));
+        return *this;
+    }
+
+    bool operator==(const TreeIterator& other) const {
+        if (path.empty() || other.path.empty()) {
+            return path.empty() == other.path.empty();
+        }
+        return path.back() == other.path.back();
+    }
+
+    bool operator!=(const TreeIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+/* A [first, last) pair of cursors usable in a range-based for */
+template<typename TreeNode>
+struct TreeRange {
+    TreeIterator<TreeNode> first;
+    TreeIterator<TreeNode> last;
+
+    TreeIterator<TreeNode> begin() const { return first; }
+    TreeIterator<TreeNode> end() const { return last; }
 };
 
+/*
+    FrozenTree
+    Read-only copy of a tree made by Freeze(), laid out for lookups rather
+    than updates. The bids sit in one array in id order (range scans read
+    it sequentially) and the search keys are kept apart from them in
+    Eytzinger order: the children of slot k are 2k and 2k+1, so the first
+    levels share a few cache lines and the slots a lookup will reach four
+    levels further down are contiguous and can be prefetched. A key is the
+    first 8 bytes of the id packed big-endian into an integer; only ids
+    sharing those 8 bytes fall back to comparing the full strings.
+*/
+class FrozenTree {
+private:
+    vector<uint64_t> keys;   // id prefixes, Eytzinger order from slot 1
+    vector<uint32_t> ranks;  // slot -> index into bids
+    vector<Bid> bids;        // sorted by id
+
+    static uint64_t prefix(string_view id) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            key = (key << 8) | (i < id.size() ? static_cast<unsigned char>(id[i]) : 0);
+        }
+        return key;
+    }
+
+    /* Place bids[next...] in the subtree rooted at slot k */
+    void layout(size_t k, size_t& next) {
+        if (k >= keys.size()) return;
+        layout(2 * k, next);
+        keys[k] = prefix(bids[next].bidId);
+        ranks[k] = static_cast<uint32_t>(next);
+        ++next;
+        layout(2 * k + 1, next);
+    }
+
+    /* Index of the first bid with id >= key (> key when `after`), bids.size() if none */
+    size_t seek(string_view bidId, bool after) const {
+        const uint64_t key = prefix(bidId);
+        const size_t n = bids.size();
+        size_t k = 1;
+        while (k <= n) {
+#if defined(__GNUC__) || defined(__clang__)
+            // the 16 slots four levels below k are adjacent
+            __builtin_prefetch(keys.data() + 16 * k);
+#endif
+            bool goRight;
+            if (keys[k] != key) {
+                goRight = keys[k] < key;
+            }
+            else {
+                int cmp = bids[ranks[k]].bidId.compare(bidId);
+                goRight = cmp < 0 || (cmp == 0 && after);
+            }
+            k = 2 * k + (goRight ? 1 : 0);
+        }
+        // undo the trailing right turns and the last left turn: k is the answer
+        while (k & 1) {
+            k >>= 1;
+        }
+        k >>= 1;
+        return k == 0 ? n : ranks[k];
+    }
+
+public:
+    /* A run of consecutive bids, usable in a range-based for */
+    struct Span {
+        const Bid* first;
+        const Bid* last;
+
+        const Bid* begin() const { return first; }
+        const Bid* end() const { return last; }
+        size_t size() const { return last - first; }
+    };
+
+    /* Build from bids already sorted by id */
+    explicit FrozenTree(vector<Bid> sorted) : bids(std::move(sorted)) {
+        keys.assign(bids.size() + 1, 0);
+        ranks.assign(bids.size() + 1, 0);
+        size_t next = 0;
+        layout(1, next);
+    }
+
+    /* Find a bid by ID without copying; nullptr if not found */
+    const Bid* Find(string_view bidId) const {
+        size_t i = seek(bidId, false);
+        if (i < bids.size() && bids[i].bidId == bidId) {
+            return &bids[i];
+        }
+        return nullptr;
+    }
+
+    /* Search for a specific bid by ID, returning a copy (empty bid if not found) */
+    Bid Search(string bidId) const {
+        const Bid* found = Find(bidId);
+        if (found != nullptr) {
+            return *found;
+        }
+
+        Bid bid;
+        return bid;
+    }
+
+    /* First bid whose id is not less than bidId, end() if none */
+    const Bid* LowerBound(string_view bidId) const {
+        return bids.data() + seek(bidId, false);
+    }
+
+    /* First bid whose id is greater than bidId, end() if none */
+    const Bid* UpperBound(string_view bidId) const {
+        return bids.data() + seek(bidId, true);
+    }
+
+    /* Bids with from <= id <= to, in id order */
+    Span Range(string_view from, string_view to) const {
+        if (to < from) {
+            return Span{ end(), end() };
+        }
+        return Span{ LowerBound(from), UpperBound(to) };
+    }
+
+    const Bid* begin() const { return bids.data(); }
+    const Bid* end() const { return bids.data() + bids.size(); }
+    size_t Size() const { return bids.size(); }
+};
+
+/* Heights only exist on AVL nodes */
+static void setHeight(Node*, int) {}
+
+/* Link nodes[lo, hi) (in id order) into a perfectly balanced tree; returns its root */
+template<typename TreeNode>
+static TreeNode* linkBalanced(const vector<TreeNode*>& nodes, size_t lo, size_t hi, int& height) {
+    if (lo == hi) {
+        height = 0;
+        return nullptr;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    TreeNode* node = nodes[mid];
+    int left, right;
+    node->left = linkBalanced(nodes, lo, mid, left);
+    node->right = linkBalanced(nodes, mid + 1, hi, right);
+    height = (left > right ? left : right) + 1;
+    setHeight(node, height);
+    node->count = static_cast<unsigned int>(hi - lo);
+    return node;
+}
+
+/*
+    Order statistics shared by the trees. Every node counts the bids in its
+    subtree, so the position of an id, or the bid at a position, is found
+    on a single root-to-leaf path.
+*/
+template<typename TreeNode>
+static unsigned int subtreeCount(const TreeNode* node) {
+    return node == nullptr ? 0 : node->count;
+}
+
+/* Bids below node with id < key, or id <= key when `inclusive` */
+template<typename TreeNode>
+static unsigned int countBelow(const TreeNode* node, string_view key, bool inclusive) {
+    unsigned int below = 0;
+    while (node != nullptr) {
+        int cmp = key.compare(bidOf(node).bidId);
+        if (cmp > 0 || (cmp == 0 && inclusive)) {
+            below += subtreeCount(raw(node->left)) + 1;
+            node = raw(node->right);
+        }
+        else {
+            node = raw(node->left);
+        }
+    }
+    return below;
+}
+
+/* The k-th bid (from 0) in id order below node; nullptr if there are not that many */
+template<typename TreeNode>
+static const Bid* selectNode(const TreeNode* node, unsigned int k) {
+    while (node != nullptr) {
+        unsigned int left = subtreeCount(raw(node->left));
+        if (k < left) {
+            node = raw(node->left);
+        }
+        else if (k == left) {
+            return &bidOf(node);
+        }
+        else {
+            k -= left + 1;
+            node = raw(node->right);
+        }
+    }
+    return nullptr;
+}
+
+/*
+    Merge bids (sorted by id, or sorted here if not) into the tree below
+    root and return the new, perfectly balanced root. Existing nodes are
+    collected in order and relinked, new ones come from newNode(bid) which
+    moves the bid in, so no bid is copied and every step is linear apart
+    from the sort. bids is left empty.
+*/
+template<typename TreeNode, typename NewNode>
+static TreeNode* mergeBalanced(TreeNode* root, vector<Bid>& bids, NewNode newNode) {
+    auto byId = [](const Bid& a, const Bid& b) { return a.bidId < b.bidId; };
+    if (!std::is_sorted(bids.begin(), bids.end(), byId)) {
+        std::stable_sort(bids.begin(), bids.end(), byId);
+    }
+
+    // nodes already in the tree, in order
+    vector<TreeNode*> existing;
+    vector<TreeNode*> path;
+    for (TreeNode* node = root; node != nullptr || !path.empty(); ) {
+        if (node != nullptr) {
+            path.push_back(node);
+            node = node->left;
+        }
+        else {
+            node = path.back();
+            path.pop_back();
+            existing.push_back(node);
+            node = node->right;
+        }
+    }
+
+    // merge, keeping existing bids ahead of new ones with the same id as Insert does
+    vector<TreeNode*> nodes;
+    nodes.reserve(existing.size() + bids.size());
+    size_t next = 0;
+    for (Bid& bid : bids) {
+        while (next < existing.size() && !(bid.bidId < existing[next]->bid.bidId)) {
+            nodes.push_back(existing[next++]);
+        }
+        nodes.push_back(newNode(bid));
+    }
+    while (next < existing.size()) {
+        nodes.push_back(existing[next++]);
+    }
+    bids.clear();
+
+    int height;
+    return linkBalanced(nodes, 0, nodes.size(), height);
+}
+
 class BinarySearchTree {
 
 private:
     Node* root;
+    NodePool<Node> pool; // every node of the tree, freed together
+    BidIndex<Bid> index; // fund and amount indexes, built by the first Query
+    bool indexed;
 
-    void addNode(Node* node, Bid bid);
+    void addNode(Node* node, Bid& bid);
     Node* removeNode(Node* node, string bidId);
-    void inOrder(Node* node);
-    void preOrder(Node* node);
-    void postOrder(Node* node);
+    void inOrder(Node* node, out::Sink& sink);
+    void preOrder(Node* node, out::Sink& sink);
+    void postOrder(Node* node, out::Sink& sink);
+    const BidIndex<Bid>& indexes();
 
 public:
     BinarySearchTree();
     virtual ~BinarySearchTree();
 
-    void InOrder();
-    void PreOrder();
-    void PostOrder();
+    void InOrder(out::Sink& sink = out::Console());
+    void PreOrder(out::Sink& sink = out::Console());
+    void PostOrder(out::Sink& sink = out::Console());
 
     void Insert(Bid bid);
+    void BulkLoad(vector<Bid>&& bids);
     void Remove(string bidId);
     Bid Search(string bidId);
+    const Bid* Find(string_view bidId) const;
+    vector<const Bid*> Query(string_view fund, double minAmount, double maxAmount);
+    unsigned int Size() const;
+
+    const Bid* Select(unsigned int k) const;
+    unsigned int Rank(string_view bidId) const;
+    unsigned int CountRange(string_view from, string_view to) const;
+    const Bid* SelectAmount(unsigned int k);
+    unsigned int RankAmount(double amount);
+    unsigned int CountAmountRange(double minAmount, double maxAmount);
+
+    typedef TreeIterator<Node> Iterator;
+    Iterator begin() const;
+    Iterator end() const;
+    Iterator LowerBound(string_view bidId) const;
+    Iterator UpperBound(string_view bidId) const;
+    TreeRange<Node> Range(string_view from, string_view to) const;
+    FrozenTree Freeze() const;
 };
 
 /* Constructor */
 BinarySearchTree::BinarySearchTree() {
     root = nullptr;
+    indexed = false;
 }
 
-/* Destructor */
+/* Destructor: the pool releases every node without walking the tree */
 BinarySearchTree::~BinarySearchTree() {
-    if (root != nullptr) {
-        std::function<void(Node*)> freeTree = [&](Node* node) {
-            if (node != nullptr) {
-                freeTree(node->left);
-                freeTree(node->right);
-                delete node;
-            }
-        };
-        freeTree(root);
-        root = nullptr;
-    }
+    pool.Clear();
+    root = nullptr;
 }
 
 /* Insert a bid into the tree */
 void BinarySearchTree::Insert(Bid bid) {
     if (root == nullptr) {
-        root = new Node(bid);
+        root = pool.New(std::move(bid));
+        if (indexed) {
+            index.Add(&root->bid);
+        }
     }
     else {
         addNode(root, bid);
     }
 }
 
+/*
+    Load a batch of bids at once, sorting it unless it already is in id
+    order, and merge it with the bids already in the tree. The result is
+    perfectly balanced whatever order the bids came in. Bids are moved out
+    of `bids`, which is left empty.
+*/
+void BinarySearchTree::BulkLoad(vector<Bid>&& bids) {
+    root = mergeBalanced(root, bids, [this](Bid& bid) {
+        Node* node = pool.New(std::move(bid));
+        if (indexed) {
+            index.Add(&node->bid);
+        }
+        return node;
+    });
+}
+
 /* Add node helper: recursively find where to place a new bid */
-void BinarySearchTree::addNode(Node* node, Bid bid) {
+void BinarySearchTree::addNode(Node* node, Bid& bid) {
+    // the bid always ends up below node
+    ++node->count;
     if (bid.bidId < node->bid.bidId) {
         if (node->left == nullptr) {
-            node->left = new Node(bid);
+            node->left = pool.New(std::move(bid));
+            if (indexed) {
+                index.Add(&node->left->bid);
+            }
         }
         else {
             addNode(node->left, bid);
@@ -88,7 +494,10 @@ void BinarySearchTree::addNode(Node* node, Bid bid) {
     }
     else {
         if (node->right == nullptr) {
-            node->right = new Node(bid);
+            node->right = pool.New(std::move(bid));
+            if (indexed) {
+                index.Add(&node->right->bid);
+            }
         }
         else {
             addNode(node->right, bid);
@@ -96,15 +505,27 @@ void BinarySearchTree::addNode(Node* node, Bid bid) {
     }
 }
 
-/* Search for a specific bid by ID */
+/* Search for a specific bid by ID, returning a copy (empty bid if not found) */
 Bid BinarySearchTree::Search(string bidId) {
-    Node* current = root;
+    const Bid* found = Find(bidId);
+    if (found != nullptr) {
+        return *found;
+    }
+
+    Bid bid;
+    return bid;
+}
+
+/* Find a bid by ID without copying; nullptr if not found */
+const Bid* BinarySearchTree::Find(string_view bidId) const {
+    const Node* current = root;
 
     while (current != nullptr) {
-        if (current->bid.bidId == bidId) {
-            return current->bid;
+        int cmp = bidId.compare(current->bid.bidId);
+        if (cmp == 0) {
+            return &current->bid;
         }
-        else if (bidId < current->bid.bidId) {
+        else if (cmp < 0) {
             current = current->left;
         }
         else {
@@ -112,8 +533,7 @@ Bid BinarySearchTree::Search(string bidId) {
         }
     }
 
-    Bid bid;
-    return bid;
+    return nullptr;
 }
 
 /* Remove a bid by ID */
@@ -134,19 +554,22 @@ Node* BinarySearchTree::removeNode(Node* node, string bidId) {
         node->right = removeNode(node->right, bidId);
     }
     else {
+        if (indexed) {
+            index.Remove(&node->bid);
+        }
         if (node->left == nullptr && node->right == nullptr) {
-            delete node;
+            pool.Delete(node);
             node = nullptr;
         }
         else if (node->left == nullptr) {
             Node* temp = node;
             node = node->right;
-            delete temp;
+            pool.Delete(temp);
         }
         else if (node->right == nullptr) {
             Node* temp = node;
             node = node->left;
-            delete temp;
+            pool.Delete(temp);
         }
         else {
             Node* temp = node->right;
@@ -155,46 +578,769 @@ Node* BinarySearchTree::removeNode(Node* node, string bidId) {
             }
             node->bid = temp->bid;
             node->right = removeNode(node->right, temp->bid.bidId);
+            // the successor's bid now lives in this node
+            if (indexed) {
+                index.Add(&node->bid);
+            }
         }
     }
+    // the id may not have been found, so recount instead of decrementing
+    if (node != nullptr) {
+        node->count = subtreeCount(node->left) + subtreeCount(node->right) + 1;
+    }
     return node;
 }
 
+/*
+    Bids of `fund` (any fund if empty) with minAmount <= amount <= maxAmount.
+    The first call indexes every bid by fund and amount; Insert and Remove
+    keep the indexes up to date after that, so a query only touches the bids
+    it returns. Pointers stay valid until the bid is removed.
+*/
+vector<const Bid*> BinarySearchTree::Query(string_view fund, double minAmount, double maxAmount) {
+    return indexes().Query(fund, minAmount, maxAmount);
+}
+
+/* The secondary indexes, built from every bid on first use */
+const BidIndex<Bid>& BinarySearchTree::indexes() {
+    if (!indexed) {
+        for (const Bid& bid : *this) {
+            index.Add(&bid);
+        }
+        indexed = true;
+    }
+    return index;
+}
+
+/* Number of bids stored */
+unsigned int BinarySearchTree::Size() const {
+    return subtreeCount(root);
+}
+
+/* The bid at position k (from 0) in id order, e.g. Select(Size() * 95 / 100); nullptr if k >= Size() */
+const Bid* BinarySearchTree::Select(unsigned int k) const {
+    return selectNode(root, k);
+}
+
+/* Number of bids whose id is less than bidId */
+unsigned int BinarySearchTree::Rank(string_view bidId) const {
+    return countBelow(root, bidId, false);
+}
+
+/* Number of bids with from <= id <= to */
+unsigned int BinarySearchTree::CountRange(string_view from, string_view to) const {
+    if (to < from) return 0;
+    return countBelow(root, to, true) - countBelow(root, from, false);
+}
+
+/* The bid at position k (from 0) by increasing amount; nullptr if k >= Size() */
+const Bid* BinarySearchTree::SelectAmount(unsigned int k) {
+    return indexes().SelectAmount(k);
+}
+
+/* Number of bids with an amount below `amount` */
+unsigned int BinarySearchTree::RankAmount(double amount) {
+    return static_cast<unsigned int>(indexes().RankAmount(amount));
+}
+
+/* Number of bids with minAmount <= amount <= maxAmount */
+unsigned int BinarySearchTree::CountAmountRange(double minAmount, double maxAmount) {
+    return static_cast<unsigned int>(indexes().CountAmount(minAmount, maxAmount));
+}
+
+/* Cursor on the smallest bid */
+BinarySearchTree::Iterator BinarySearchTree::begin() const {
+    return Iterator::First(root);
+}
+
+/* Cursor past the largest bid */
+BinarySearchTree::Iterator BinarySearchTree::end() const {
+    return Iterator();
+}
+
+/* Cursor on the first bid whose id is not less than bidId */
+BinarySearchTree::Iterator BinarySearchTree::LowerBound(string_view bidId) const {
+    return Iterator::Seek(root, bidId, false);
+}
+
+/* Cursor on the first bid whose id is greater than bidId */
+BinarySearchTree::Iterator BinarySearchTree::UpperBound(string_view bidId) const {
+    return Iterator::Seek(root, bidId, true);
+}
+
+/* Bids with from <= id <= to, in id order */
+TreeRange<Node> BinarySearchTree::Range(string_view from, string_view to) const {
+    if (to < from) {
+        return TreeRange<Node>{ end(), end() };
+    }
+    return TreeRange<Node>{ LowerBound(from), UpperBound(to) };
+}
+
+/* Read-only copy of the current bids laid out for fast lookups and scans */
+FrozenTree BinarySearchTree::Freeze() const {
+    vector<Bid> sorted;
+    sorted.reserve(pool.Size());
+    for (const Bid& bid : *this) {
+        sorted.push_back(bid);
+    }
+    return FrozenTree(std::move(sorted));
+}
+
 /* In-order traversal */
-void BinarySearchTree::InOrder() {
-    inOrder(root);
+void BinarySearchTree::InOrder(out::Sink& sink) {
+    inOrder(root, sink);
+    sink.Flush();
 }
 
 /* Pre-order traversal */
-void BinarySearchTree::PreOrder() {
-    preOrder(root);
+void BinarySearchTree::PreOrder(out::Sink& sink) {
+    preOrder(root, sink);
+    sink.Flush();
 }
 
 /* Post-order traversal */
-void BinarySearchTree::PostOrder() {
-    postOrder(root);
+void BinarySearchTree::PostOrder(out::Sink& sink) {
+    postOrder(root, sink);
+    sink.Flush();
 }
 
 /* Recursive in-order traversal helper */
-void BinarySearchTree::inOrder(Node* node) {
+void BinarySearchTree::inOrder(Node* node, out::Sink& sink) {
     if (node == nullptr) return;
-    inOrder(node->left);
-    cout << node->bid.bidId << ": " << node->bid.title << " | " << node->bid.amount << " | " << node->bid.fund << endl;
-    inOrder(node->right);
+    inOrder(node->left, sink);
+    writeBid(sink, node->bid);
+    inOrder(node->right, sink);
 }
 
 /* Recursive pre-order traversal helper */
-void BinarySearchTree::preOrder(Node* node) {
+void BinarySearchTree::preOrder(Node* node, out::Sink& sink) {
     if (node == nullptr) return;
-    cout << node->bid.bidId << ": " << node->bid.title << " | " << node->bid.amount << " | " << node->bid.fund << endl;
-    preOrder(node->left);
-    preOrder(node->right);
+    writeBid(sink, node->bid);
+    preOrder(node->left, sink);
+    preOrder(node->right, sink);
 }
 
 /* Recursive post-order traversal helper */
-void BinarySearchTree::postOrder(Node* node) {
+void BinarySearchTree::postOrder(Node* node, out::Sink& sink) {
     if (node == nullptr) return;
-    postOrder(node->left);
-    postOrder(node->right);
-    cout << node->bid.bidId << ": " << node->bid.title << " | " << node->bid.amount << " | " << node->bid.fund << endl;
+    postOrder(node->left, sink);
+    postOrder(node->right, sink);
+    writeBid(sink, node->bid);
+}
+
+/*
+    AVLTree
+    Self-balancing alternative to BinarySearchTree with the same interface.
+    Every node keeps the height of its subtree and Insert/Remove rotate on
+    the way back up whenever the two sides differ by more than one, so the
+    height stays below 1.45 log2(n) whatever order the bids arrive in (a
+    file sorted by id turns BinarySearchTree into a linked list). The
+    recursion is therefore bounded by the height too.
+*/
+
+struct AVLNode {
+    Bid bid;
+    AVLNode* left;
+    AVLNode* right;
+    int height; // of the subtree rooted here, a leaf is 1
+    unsigned int count; // bids in the subtree rooted here
+
+    AVLNode(Bid aBid) : bid(std::move(aBid)), left(nullptr), right(nullptr), height(1), count(1) {}
+};
+
+static void setHeight(AVLNode* node, int height) {
+    node->height = height;
+}
+
+class AVLTree {
+
+private:
+    AVLNode* root;
+    NodePool<AVLNode> pool; // every node of the tree, freed together
+
+    static int height(const AVLNode* node);
+    static void update(AVLNode* node);
+    static AVLNode* rotateLeft(AVLNode* node);
+    static AVLNode* rotateRight(AVLNode* node);
+    static AVLNode* balance(AVLNode* node);
+    AVLNode* addNode(AVLNode* node, Bid& bid);
+    AVLNode* removeNode(AVLNode* node, string_view bidId);
+    AVLNode* removeMin(AVLNode* node, AVLNode*& min);
+    void inOrder(AVLNode* node, out::Sink& sink);
+    void preOrder(AVLNode* node, out::Sink& sink);
+    void postOrder(AVLNode* node, out::Sink& sink);
+
+public:
+    AVLTree();
+    virtual ~AVLTree();
+
+    void InOrder(out::Sink& sink = out::Console());
+    void PreOrder(out::Sink& sink = out::Console());
+    void PostOrder(out::Sink& sink = out::Console());
+
+    void Insert(Bid bid);
+    void BulkLoad(vector<Bid>&& bids);
+    void Remove(string bidId);
+    Bid Search(string bidId);
+    const Bid* Find(string_view bidId) const;
+    unsigned int Size() const;
+    int Height() const;
+
+    const Bid* Select(unsigned int k) const;
+    unsigned int Rank(string_view bidId) const;
+    unsigned int CountRange(string_view from, string_view to) const;
+
+    typedef TreeIterator<AVLNode> Iterator;
+    Iterator begin() const;
+    Iterator end() const;
+    Iterator LowerBound(string_view bidId) const;
+    Iterator UpperBound(string_view bidId) const;
+    TreeRange<AVLNode> Range(string_view from, string_view to) const;
+    FrozenTree Freeze() const;
+};
+
+/* Constructor */
+AVLTree::AVLTree() {
+    root = nullptr;
+}
+
+/* Destructor: the pool releases every node without walking the tree */
+AVLTree::~AVLTree() {
+    pool.Clear();
+    root = nullptr;
+}
+
+/* Height of a possibly empty subtree */
+int AVLTree::height(const AVLNode* node) {
+    return node == nullptr ? 0 : node->height;
+}
+
+/* Recompute a node's height and count from its children */
+void AVLTree::update(AVLNode* node) {
+    int left = height(node->left);
+    int right = height(node->right);
+    node->height = (left > right ? left : right) + 1;
+    node->count = subtreeCount(node->left) + subtreeCount(node->right) + 1;
+}
+
+/* Right child becomes the subtree root */
+AVLNode* AVLTree::rotateLeft(AVLNode* node) {
+    AVLNode* pivot = node->right;
+    node->right = pivot->left;
+    pivot->left = node;
+    update(node);
+    update(pivot);
+    return pivot;
+}
+
+/* Left child becomes the subtree root */
+AVLNode* AVLTree::rotateRight(AVLNode* node) {
+    AVLNode* pivot = node->left;
+    node->left = pivot->right;
+    pivot->right = node;
+    update(node);
+    update(pivot);
+    return pivot;
+}
+
+/* Restore the AVL property at node after one of its subtrees changed by one level */
+AVLNode* AVLTree::balance(AVLNode* node) {
+    update(node);
+    int skew = height(node->left) - height(node->right);
+
+    if (skew > 1) {
+        if (height(node->left->left) < height(node->left->right)) {
+            node->left = rotateLeft(node->left);
+        }
+        return rotateRight(node);
+    }
+    if (skew < -1) {
+        if (height(node->right->right) < height(node->right->left)) {
+            node->right = rotateRight(node->right);
+        }
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+/* Insert a bid into the tree */
+void AVLTree::Insert(Bid bid) {
+    root = addNode(root, bid);
+}
+
+/*
+    Load a batch of bids at once, sorting it unless it already is in id
+    order, and merge it with the bids already in the tree. A perfectly
+    balanced tree is a valid AVL tree, so no rotations are needed. Bids are
+    moved out of `bids`, which is left empty.
+*/
+void AVLTree::BulkLoad(vector<Bid>&& bids) {
+    root = mergeBalanced(root, bids, [this](Bid& bid) {
+        return pool.New(std::move(bid));
+    });
+}
+
+/* Add node helper: place the bid below node and rebalance on the way back up */
+AVLNode* AVLTree::addNode(AVLNode* node, Bid& bid) {
+    if (node == nullptr) {
+        return pool.New(std::move(bid));
+    }
+
+    if (bid.bidId < node->bid.bidId) {
+        node->left = addNode(node->left, bid);
+    }
+    else {
+        node->right = addNode(node->right, bid);
+    }
+    return balance(node);
+}
+
+/* Search for a specific bid by ID, returning a copy (empty bid if not found) */
+Bid AVLTree::Search(string bidId) {
+    const Bid* found = Find(bidId);
+    if (found != nullptr) {
+        return *found;
+    }
+
+    Bid bid;
+    return bid;
+}
+
+/* Find a bid by ID without copying; nullptr if not found */
+const Bid* AVLTree::Find(string_view bidId) const {
+    const AVLNode* current = root;
+
+    while (current != nullptr) {
+        int cmp = bidId.compare(current->bid.bidId);
+        if (cmp == 0) {
+            return &current->bid;
+        }
+        else if (cmp < 0) {
+            current = current->left;
+        }
+        else {
+            current = current->right;
+        }
+    }
+
+    return nullptr;
+}
+
+/* Remove a bid by ID */
+void AVLTree::Remove(string bidId) {
+    root = removeNode(root, bidId);
+}
+
+/* Recursive remove helper */
+AVLNode* AVLTree::removeNode(AVLNode* node, string_view bidId) {
+    if (node == nullptr) {
+        return node;
+    }
+
+    int cmp = bidId.compare(node->bid.bidId);
+    if (cmp < 0) {
+        node->left = removeNode(node->left, bidId);
+    }
+    else if (cmp > 0) {
+        node->right = removeNode(node->right, bidId);
+    }
+    else {
+        AVLNode* left = node->left;
+        AVLNode* right = node->right;
+        pool.Delete(node);
+
+        if (right == nullptr) {
+            return left;
+        }
+        // the in-order successor takes the removed node's place
+        AVLNode* successor;
+        right = removeMin(right, successor);
+        successor->left = left;
+        successor->right = right;
+        return balance(successor);
+    }
+    return balance(node);
+}
+
+/* Unlink the smallest node below node into min, returning the rebalanced subtree */
+AVLNode* AVLTree::removeMin(AVLNode* node, AVLNode*& min) {
+    if (node->left == nullptr) {
+        min = node;
+        return node->right;
+    }
+    node->left = removeMin(node->left, min);
+    return balance(node);
+}
+
+/* Number of bids stored */
+unsigned int AVLTree::Size() const {
+    return pool.Size();
+}
+
+/* The bid at position k (from 0) in id order; nullptr if k >= Size() */
+const Bid* AVLTree::Select(unsigned int k) const {
+    return selectNode(root, k);
+}
+
+/* Number of bids whose id is less than bidId */
+unsigned int AVLTree::Rank(string_view bidId) const {
+    return countBelow(root, bidId, false);
+}
+
+/* Number of bids with from <= id <= to */
+unsigned int AVLTree::CountRange(string_view from, string_view to) const {
+    if (to < from) return 0;
+    return countBelow(root, to, true) - countBelow(root, from, false);
+}
+
+/* Height of the tree, 0 when empty */
+int AVLTree::Height() const {
+    return height(root);
+}
+
+/* Cursor on the smallest bid */
+AVLTree::Iterator AVLTree::begin() const {
+    return Iterator::First(root);
+}
+
+/* Cursor past the largest bid */
+AVLTree::Iterator AVLTree::end() const {
+    return Iterator();
+}
+
+/* Cursor on the first bid whose id is not less than bidId */
+AVLTree::Iterator AVLTree::LowerBound(string_view bidId) const {
+    return Iterator::Seek(root, bidId, false);
+}
+
+/* Cursor on the first bid whose id is greater than bidId */
+AVLTree::Iterator AVLTree::UpperBound(string_view bidId) const {
+    return Iterator::Seek(root, bidId, true);
+}
+
+/* Bids with from <= id <= to, in id order */
+TreeRange<AVLNode> AVLTree::Range(string_view from, string_view to) const {
+    if (to < from) {
+        return TreeRange<AVLNode>{ end(), end() };
+    }
+    return TreeRange<AVLNode>{ LowerBound(from), UpperBound(to) };
+}
+
+/* Read-only copy of the current bids laid out for fast lookups and scans */
+FrozenTree AVLTree::Freeze() const {
+    vector<Bid> sorted;
+    sorted.reserve(pool.Size());
+    for (const Bid& bid : *this) {
+        sorted.push_back(bid);
+    }
+    return FrozenTree(std::move(sorted));
+}
+
+/* In-order traversal */
+void AVLTree::InOrder(out::Sink& sink) {
+    inOrder(root, sink);
+    sink.Flush();
+}
+
+/* Pre-order traversal */
+void AVLTree::PreOrder(out::Sink& sink) {
+    preOrder(root, sink);
+    sink.Flush();
+}
+
+/* Post-order traversal */
+void AVLTree::PostOrder(out::Sink& sink) {
+    postOrder(root, sink);
+    sink.Flush();
+}
+
+/* Recursive in-order traversal helper */
+void AVLTree::inOrder(AVLNode* node, out::Sink& sink) {
+    if (node == nullptr) return;
+    inOrder(node->left, sink);
+    writeBid(sink, node->bid);
+    inOrder(node->right, sink);
+}
+
+/* Recursive pre-order traversal helper */
+void AVLTree::preOrder(AVLNode* node, out::Sink& sink) {
+    if (node == nullptr) return;
+    writeBid(sink, node->bid);
+    preOrder(node->left, sink);
+    preOrder(node->right, sink);
+}
+
+/* Recursive post-order traversal helper */
+void AVLTree::postOrder(AVLNode* node, out::Sink& sink) {
+    if (node == nullptr) return;
+    postOrder(node->left, sink);
+    postOrder(node->right, sink);
+    writeBid(sink, node->bid);
+}
+
+/*
+    PersistentTree
+    Balanced bid tree whose versions are immutable, so reporting scans can
+    run while bids are being updated. Insert and Remove never touch an
+    existing node: they copy the O(log n) nodes on the path to the change
+    (path copying, rebalancing AVL style) and share every other subtree
+    with the previous version, then publish the new root with one atomic
+    store. The copied nodes share the bid itself, so a new version costs a
+    few small nodes and reference count updates, never a Bid copy.
+    Writers are serialised by a mutex. Pin() atomically loads the current
+    root into a Snapshot; everything it reaches stays alive and unchanged
+    for as long as the snapshot is held, and reading it takes no lock.
+    The root is published with atomic_load/atomic_store on the shared_ptr,
+    which libstdc++ implements with a small pool of mutexes: Pin() and the
+    publishing store briefly lock one of them to copy the pointer, so
+    pinning is not lock-free, but a reader never waits for a writer to
+    build its version. Nodes are reference counted, so a version is freed
+    as soon as the tree and every snapshot have moved past it.
+*/
+
+struct PersistentNode {
+    typedef shared_ptr<const PersistentNode> Ref;
+    typedef shared_ptr<const Bid> BidRef;
+
+    BidRef bid;  // shared by the copies of this node in later versions
+    Ref left;
+    Ref right;
+    int height; // of the subtree rooted here, a leaf is 1
+    unsigned int count; // bids in the subtree rooted here
+};
+
+static const Bid& bidOf(const PersistentNode* node) {
+    return *node->bid;
+}
+
+class PersistentTree {
+
+public:
+    typedef PersistentNode::Ref Ref;
+    typedef PersistentNode::BidRef BidRef;
+
+    /* One immutable version of the tree */
+    class Snapshot {
+    private:
+        Ref root;
+
+    public:
+        explicit Snapshot(Ref aRoot) : root(std::move(aRoot)) {}
+
+        /* Find a bid by ID; the pointer is valid while this snapshot lives */
+        const Bid* Find(string_view bidId) const {
+            const PersistentNode* current = root.get();
+
+            while (current != nullptr) {
+                int cmp = bidId.compare(current->bid->bidId);
+                if (cmp == 0) {
+                    return current->bid.get();
+                }
+                else if (cmp < 0) {
+                    current = current->left.get();
+                }
+                else {
+                    current = current->right.get();
+                }
+            }
+
+            return nullptr;
+        }
+
+        unsigned int Size() const { return subtreeCount(root.get()); }
+        const Bid* Select(unsigned int k) const { return selectNode(root.get(), k); }
+        unsigned int Rank(string_view bidId) const { return countBelow(root.get(), bidId, false); }
+
+        TreeIterator<PersistentNode> begin() const {
+            return TreeIterator<PersistentNode>::First(root.get());
+        }
+
+        TreeIterator<PersistentNode> end() const {
+            return TreeIterator<PersistentNode>();
+        }
+
+        TreeIterator<PersistentNode> LowerBound(string_view bidId) const {
+            return TreeIterator<PersistentNode>::Seek(root.get(), bidId, false);
+        }
+
+        TreeIterator<PersistentNode> UpperBound(string_view bidId) const {
+            return TreeIterator<PersistentNode>::Seek(root.get(), bidId, true);
+        }
+
+        /* Bids with from <= id <= to, in id order */
+        TreeRange<PersistentNode> Range(string_view from, string_view to) const {
+            if (to < from) {
+                return TreeRange<PersistentNode>{ end(), end() };
+            }
+            return TreeRange<PersistentNode>{ LowerBound(from), UpperBound(to) };
+        }
+    };
+
+private:
+    Ref root;      // read and written with atomic_load/atomic_store only
+    mutex writer;  // one Insert/Remove at a time
+
+    static int height(const Ref& node);
+    static Ref make(BidRef bid, Ref left, Ref right);
+    static Ref join(const BidRef& bid, Ref left, Ref right);
+    static Ref addNode(const Ref& node, BidRef& bid);
+    static Ref removeNode(const Ref& node, string_view bidId, bool& removed);
+    static Ref removeMin(const Ref& node, BidRef& min);
+
+public:
+    PersistentTree();
+    virtual ~PersistentTree();
+
+    Snapshot Pin() const;
+    void Insert(Bid bid);
+    void Remove(string bidId);
+    Bid Search(string bidId) const;
+    unsigned int Size() const;
+    void InOrder(out::Sink& sink = out::Console()) const;
+};
+
+/* Constructor */
+PersistentTree::PersistentTree() {
+}
+
+/* Destructor: nodes still shared with live snapshots outlive the tree */
+PersistentTree::~PersistentTree() {
+}
+
+/* Height of a possibly empty subtree */
+int PersistentTree::height(const Ref& node) {
+    return node == nullptr ? 0 : node->height;
+}
+
+/* New node over two existing subtrees */
+PersistentTree::Ref PersistentTree::make(BidRef bid, Ref left, Ref right) {
+    int leftHeight = height(left);
+    int rightHeight = height(right);
+    unsigned int count = subtreeCount(left.get()) + subtreeCount(right.get()) + 1;
+    int nodeHeight = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+    return make_shared<const PersistentNode>(
+        PersistentNode{ std::move(bid), std::move(left), std::move(right), nodeHeight, count });
+}
+
+/*
+    New node for bid over left and right, which differ in height by at most
+    two; rotates (by building new nodes) when they differ by two.
+*/
+PersistentTree::Ref PersistentTree::join(const BidRef& bid, Ref left, Ref right) {
+    int skew = height(left) - height(right);
+
+    if (skew > 1) {
+        if (height(left->left) >= height(left->right)) {
+            return make(left->bid, left->left, make(bid, left->right, std::move(right)));
+        }
+        const Ref& pivot = left->right;
+        return make(pivot->bid, make(left->bid, left->left, pivot->left),
+                    make(bid, pivot->right, std::move(right)));
+    }
+    if (skew < -1) {
+        if (height(right->right) >= height(right->left)) {
+            return make(right->bid, make(bid, std::move(left), right->left), right->right);
+        }
+        const Ref& pivot = right->left;
+        return make(pivot->bid, make(bid, std::move(left), pivot->left),
+                    make(right->bid, pivot->right, right->right));
+    }
+    return make(bid, std::move(left), std::move(right));
+}
+
+/* Version of node's subtree with bid added */
+PersistentTree::Ref PersistentTree::addNode(const Ref& node, BidRef& bid) {
+    if (node == nullptr) {
+        return make(std::move(bid), nullptr, nullptr);
+    }
+    if (bid->bidId < node->bid->bidId) {
+        return join(node->bid, addNode(node->left, bid), node->right);
+    }
+    return join(node->bid, node->left, addNode(node->right, bid));
+}
+
+/* Version of node's subtree without bidId; node itself if it was not found */
+PersistentTree::Ref PersistentTree::removeNode(const Ref& node, string_view bidId, bool& removed) {
+    if (node == nullptr) {
+        return node;
+    }
+
+    int cmp = bidId.compare(node->bid->bidId);
+    if (cmp < 0) {
+        Ref left = removeNode(node->left, bidId, removed);
+        return removed ? join(node->bid, std::move(left), node->right) : node;
+    }
+    if (cmp > 0) {
+        Ref right = removeNode(node->right, bidId, removed);
+        return removed ? join(node->bid, node->left, std::move(right)) : node;
+    }
+
+    removed = true;
+    if (node->left == nullptr) {
+        return node->right;
+    }
+    if (node->right == nullptr) {
+        return node->left;
+    }
+    // the in-order successor takes the removed bid's place
+    BidRef successor;
+    Ref right = removeMin(node->right, successor);
+    return join(successor, node->left, std::move(right));
+}
+
+/* Version of node's subtree without its smallest bid, which is handed to min */
+PersistentTree::Ref PersistentTree::removeMin(const Ref& node, BidRef& min) {
+    if (node->left == nullptr) {
+        min = node->bid;
+        return node->right;
+    }
+    return join(node->bid, removeMin(node->left, min), node->right);
+}
+
+/* The current version; never changes however the tree is updated afterwards */
+PersistentTree::Snapshot PersistentTree::Pin() const {
+    return Snapshot(atomic_load(&root));
+}
+
+/* Insert a bid, publishing a new version */
+void PersistentTree::Insert(Bid bid) {
+    BidRef shared = make_shared<const Bid>(std::move(bid));
+    lock_guard<mutex> lock(writer);
+    atomic_store(&root, addNode(atomic_load(&root), shared));
+}
+
+/* Remove a bid by ID, publishing a new version if it was found */
+void PersistentTree::Remove(string bidId) {
+    lock_guard<mutex> lock(writer);
+    bool removed = false;
+    Ref next = removeNode(atomic_load(&root), bidId, removed);
+    if (removed) {
+        atomic_store(&root, next);
+    }
+}
+
+/* Search the current version for a bid by ID, returning a copy (empty bid if not found) */
+Bid PersistentTree::Search(string bidId) const {
+    Snapshot snapshot = Pin();
+    const Bid* found = snapshot.Find(bidId);
+    if (found != nullptr) {
+        return *found;
+    }
+
+    Bid bid;
+    return bid;
+}
+
+/* Number of bids in the current version */
+unsigned int PersistentTree::Size() const {
+    return Pin().Size();
+}
+
+/* In-order listing of the current version */
+void PersistentTree::InOrder(out::Sink& sink) const {
+    Snapshot snapshot = Pin();
+    for (const Bid& bid : snapshot) {
+        writeBid(sink, bid);
+    }
+    sink.Flush();
 }
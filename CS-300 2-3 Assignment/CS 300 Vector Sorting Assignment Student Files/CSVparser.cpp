@@ -1,12 +1,276 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <thread>
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+# define CSV_SIMD_X86
+# include <immintrin.h>
+#endif
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
 #include "CSVparser.hpp"
 
 namespace csv {
 
-  Parser::Parser(const std::string &data, const DataType &type, char sep)
-    : _type(type), _sep(sep)
+  /*
+  ** SEPARATOR SCANNING
+  **
+  ** Records the position of every separator that is outside quotes. The
+  ** vector kernels compare 16 (SSE2) or 32 (AVX2) bytes at once against the
+  ** separator and '"', turn the quote bitmask into an "inside quotes" mask
+  ** with a prefix xor, and carry the quote state from block to block. The
+  ** kernel is picked once at runtime from what the cpu supports.
+  */
+  typedef void (*SeparatorScan)(const char *, std::size_t, char, std::vector<std::size_t> &);
+
+  static void scanScalar(const char *line, std::size_t begin, std::size_t len,
+                         char sep, bool quoted, std::vector<std::size_t> &out)
+  {
+      for (std::size_t i = begin; i != len; i++)
+      {
+          if (line[i] == '"')
+              quoted = ((quoted) ? (false) : (true));
+          else if (line[i] == sep && !quoted)
+              out.push_back(i);
+      }
+  }
+
+#ifdef CSV_SIMD_X86
+  static inline uint32_t prefixXor(uint32_t mask)
+  {
+      mask ^= mask << 1;
+      mask ^= mask << 2;
+      mask ^= mask << 4;
+      mask ^= mask << 8;
+      mask ^= mask << 16;
+      return mask;
+  }
+
+  static void scanSeparatorsSSE2(const char *line, std::size_t len, char sep,
+                                 std::vector<std::size_t> &out)
+  {
+      const __m128i quote = _mm_set1_epi8('"');
+      const __m128i separator = _mm_set1_epi8(sep);
+      uint32_t inside = 0; // all ones when the previous block ended inside quotes
+      std::size_t i = 0;
+
+      for (; i + 16 <= len; i += 16)
+      {
+          __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line + i));
+          uint32_t quotes = _mm_movemask_epi8(_mm_cmpeq_epi8(block, quote));
+          uint32_t seps = _mm_movemask_epi8(_mm_cmpeq_epi8(block, separator));
+          uint32_t quoted = (prefixXor(quotes) ^ inside) & 0xFFFF;
+          uint32_t hits = seps & ~quoted;
+
+          while (hits != 0)
+          {
+              out.push_back(i + __builtin_ctz(hits));
+              hits &= hits - 1;
+          }
+          inside = 0 - ((quoted >> 15) & 1);
+      }
+      scanScalar(line, i, len, sep, inside != 0, out);
+  }
+
+  __attribute__((target("avx2")))
+  static void scanSeparatorsAVX2(const char *line, std::size_t len, char sep,
+                                 std::vector<std::size_t> &out)
+  {
+      const __m256i quote = _mm256_set1_epi8('"');
+      const __m256i separator = _mm256_set1_epi8(sep);
+      uint32_t inside = 0; // all ones when the previous block ended inside quotes
+      std::size_t i = 0;
+
+      for (; i + 32 <= len; i += 32)
+      {
+          __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(line + i));
+          uint32_t quotes = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, quote));
+          uint32_t seps = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, separator));
+          uint32_t quoted = prefixXor(quotes) ^ inside;
+          uint32_t hits = seps & ~quoted;
+
+          while (hits != 0)
+          {
+              out.push_back(i + __builtin_ctz(hits));
+              hits &= hits - 1;
+          }
+          inside = 0 - (quoted >> 31);
+      }
+      scanScalar(line, i, len, sep, inside != 0, out);
+  }
+#else
+  static void scanSeparatorsScalar(const char *line, std::size_t len, char sep,
+                                   std::vector<std::size_t> &out)
+  {
+      scanScalar(line, 0, len, sep, false, out);
+  }
+#endif
+
+  static SeparatorScan selectSeparatorScan(void)
+  {
+#ifdef CSV_SIMD_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+          return scanSeparatorsAVX2;
+      return scanSeparatorsSSE2;
+#else
+      return scanSeparatorsScalar;
+#endif
+  }
+
+  static void scanSeparators(const char *line, std::size_t len, char sep,
+                             std::vector<std::size_t> &out)
+  {
+      static const SeparatorScan scan = selectSeparatorScan();
+
+      out.clear();
+      scan(line, len, sep, out);
+  }
+
+  /*
+  ** getline that also drops the '\r' of a CRLF line ending, so the last
+  ** column of files saved on Windows does not keep it
+  */
+  static std::istream &readLine(std::istream &in, std::string &line)
+  {
+      if (std::getline(in, line) && !line.empty() && line.back() == '\r')
+          line.pop_back();
+      return in;
+  }
+
+  static std::string_view chompCR(std::string_view line)
+  {
+      if (!line.empty() && line.back() == '\r')
+          line.remove_suffix(1);
+      return line;
+  }
+
+  /*
+  ** push the fields of an already scanned line into the next columns of the
+  ** table and return the number of fields found
+  */
+  static unsigned int pushFields(const std::string &line, const std::vector<std::size_t> &seps,
+                                 Table &table)
+  {
+      std::size_t tokenStart = 0;
+      unsigned int col = 0;
+
+      for (std::size_t n = 0; n != seps.size(); n++)
+      {
+          table.push(col++, line.data() + tokenStart, seps[n] - tokenStart);
+          tokenStart = seps[n] + 1;
+      }
+
+      //end
+      table.push(col++, line.data() + tokenStart, line.length() - tokenStart);
+      return col;
+  }
+
+  /*
+  ** split one line on the separator (outside quotes), push every field into
+  ** the next column of the table and return the number of fields found
+  */
+  static unsigned int splitLine(const std::string &line, char sep, Table &table,
+                                std::vector<std::size_t> &seps)
+  {
+      scanSeparators(line.data(), line.length(), sep, seps);
+      return pushFields(line, seps, table);
+  }
+
+  /*
+  ** QUOTING
+  */
+
+  /*
+  ** value of a raw field : a field wrapped in quotes loses them and its
+  ** doubled quotes are collapsed into scratch, anything else is returned
+  ** as is. The result is valid until scratch is used again.
+  */
+  std::string_view unquote(std::string_view field, std::string &scratch)
+  {
+      if (field.size() < 2 || field.front() != '"' || field.back() != '"')
+          return field;
+      field = field.substr(1, field.size() - 2);
+      if (field.find('"') == std::string_view::npos)
+          return field;
+
+      scratch.clear();
+      for (std::size_t i = 0; i != field.size(); i++)
+      {
+          scratch.push_back(field[i]);
+          if (field[i] == '"' && i + 1 != field.size() && field[i + 1] == '"')
+              i++;
+      }
+      return scratch;
+  }
+
+  /*
+  ** CURRENCY
+  */
+
+  double parseCurrency(std::string_view value)
+  {
+      static const double scale[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                      1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+                                      1e15, 1e16, 1e17, 1e18 };
+      uint64_t whole = 0;
+      double wide = 0;  // whole part once it has more digits than whole holds
+      uint64_t fraction = 0;
+      unsigned int decimals = 0;
+      unsigned int wholeDigits = 0;
+      bool negative = false;
+      bool inFraction = false;
+
+      // quotes, '$', ',' and blanks are skipped, so "$3,000 " gives 3000
+      for (std::size_t i = 0; i != value.size(); i++)
+      {
+          char c = value[i];
+
+          if (c >= '0' && c <= '9')
+          {
+              if (inFraction)
+              {
+                  // decimals past the 18th are below double precision anyway
+                  if (decimals < 18)
+                  {
+                      fraction = fraction * 10 + (c - '0');
+                      decimals++;
+                  }
+              }
+              else if (wholeDigits < 19)
+              {
+                  whole = whole * 10 + (c - '0');
+                  wholeDigits++;
+              }
+              else
+                  wide = (wholeDigits++ == 19 ? static_cast<double>(whole) : wide) * 10 + (c - '0');
+          }
+          else if (c == '.' && !inFraction)
+              inFraction = true;
+          else if (c == '-' || c == '(')
+              negative = true;
+          else if (c != '$' && c != ',' && c != ' ' && c != '"' && c != ')' && c != '\r')
+              break;
+      }
+
+      double result = (wholeDigits > 19 ? wide : whole) + fraction / scale[decimals];
+      return negative ? -result : result;
+  }
+
+  Parser::Parser(const std::string &data, const DataType &type, char sep,
+                 unsigned int threads)
+    : _type(type), _sep(sep), _content(NULL), _journaled(false),
+      _compactAfter(DEFAULT_JOURNAL_LIMIT)
   {
       std::string line;
       if (type == eFILE)
@@ -17,7 +281,7 @@ namespace csv {
         {
             while (ifile.good())
             {
-                getline(ifile, line);
+                readLine(ifile, line);
                 if (line != "")
                     _originalFile.push_back(line);
             }
@@ -27,7 +291,17 @@ namespace csv {
               throw Error(std::string("No Data in ").append(_file));
             
             parseHeader();
-            parseContent();
+            try
+            {
+              parseContent(threads);
+              replayJournal();
+            }
+            catch (...)
+            {
+              // the destructor will not run
+              delete _content;
+              throw;
+            }
         }
         else
             throw Error(std::string("Failed to open ").append(_file));
@@ -35,152 +309,342 @@ namespace csv {
       else
       {
         std::istringstream stream(data);
-        while (std::getline(stream, line))
+        while (readLine(stream, line))
           if (line != "")
             _originalFile.push_back(line);
         if (_originalFile.size() == 0)
           throw Error(std::string("No Data in pure content"));
 
         parseHeader();
-        parseContent();
+        try
+        {
+          parseContent(threads);
+        }
+        catch (...)
+        {
+          delete _content;
+          throw;
+        }
       }
   }
 
   Parser::~Parser(void)
   {
-     std::vector<Row *>::iterator it;
-
-     for (it = _content.begin(); it != _content.end(); it++)
-          delete *it;
+     delete _content;
   }
 
   void Parser::parseHeader(void)
   {
       std::stringstream ss(_originalFile[0]);
       std::string item;
+      std::vector<std::string> header;
 
       while (std::getline(ss, item, _sep))
-          _header.push_back(item);
+          header.push_back(item);
+      _content = new Table(header);
   }
 
-  void Parser::parseContent(void)
+  /*
+  ** split lines [first, last) into the next rows of table
+  */
+  static void parseLines(const std::vector<std::string> &lines, std::size_t first,
+                         std::size_t last, char sep, Table &table)
   {
-     std::vector<std::string>::iterator it;
-     
-     it = _originalFile.begin();
-     it++; // skip header
-
-     for (; it != _originalFile.end(); it++)
+     std::vector<std::size_t> seps;
+     for (std::size_t n = first; n != last; n++)
      {
-         bool quoted = false;
-         int tokenStart = 0;
-         unsigned int i = 0;
+         // if value(s) missing
+         if (splitLine(lines[n], sep, table, seps) != table.columnCount())
+          throw Error("corrupted data !");
+     }
+  }
 
-         Row *row = new Row(_header);
+  void Parser::parseContent(unsigned int threads)
+  {
+     // line 0 is the header
+     std::size_t rows = _originalFile.size() - 1;
 
-         for (; i != it->length(); i++)
-         {
-              if (it->at(i) == '"')
-                  quoted = ((quoted) ? (false) : (true));
-              else if (it->at(i) == ',' && !quoted)
-              {
-                  row->push(it->substr(tokenStart, i - tokenStart));
-                  tokenStart = i + 1;
-              }
-         }
+     if (threads == 0)
+         threads = std::thread::hardware_concurrency();
+     if (threads == 0 || rows < static_cast<std::size_t>(threads) * MIN_CHUNK_ROWS)
+         threads = 1;
+     if (threads == 1)
+     {
+         parseLines(_originalFile, 1, _originalFile.size(), _sep, *_content);
+         return;
+     }
 
-         //end
-         row->push(it->substr(tokenStart, it->length() - tokenStart));
+     // every line is already a whole record, so the rows split evenly
+     std::vector<Table> chunks(threads, Table(_content->header()));
+     std::vector<std::exception_ptr> errors(threads);
+     std::vector<std::thread> workers;
 
-         // if value(s) missing
-         if (row->size() != _header.size())
-          throw Error("corrupted data !");
-         _content.push_back(row);
+     for (unsigned int t = 0; t < threads; t++)
+     {
+         workers.push_back(std::thread([&, t]() {
+             try
+             {
+                 parseLines(_originalFile, 1 + rows * t / threads,
+                            1 + rows * (t + 1) / threads, _sep, chunks[t]);
+             }
+             catch (...)
+             {
+                 errors[t] = std::current_exception();
+             }
+         }));
+     }
+     for (unsigned int t = 0; t < threads; t++)
+         workers[t].join();
+
+     // stitch the chunks back in file order
+     for (unsigned int t = 0; t < threads; t++)
+     {
+         if (errors[t])
+             std::rethrow_exception(errors[t]);
+         _content->append(chunks[t]);
      }
   }
 
-  Row &Parser::getRow(unsigned int rowPosition) const
+  Row Parser::getRow(unsigned int rowPosition) const
   {
-      if (rowPosition < _content.size())
-          return *(_content[rowPosition]);
+      if (rowPosition < _content->rowCount())
+          return Row(*_content, rowPosition);
       throw Error("can't return this row (doesn't exist)");
   }
 
-  Row &Parser::operator[](unsigned int rowPosition) const
+  Row Parser::operator[](unsigned int rowPosition) const
   {
       return Parser::getRow(rowPosition);
   }
 
   unsigned int Parser::rowCount(void) const
   {
-      return _content.size();
+      return _content->rowCount();
   }
 
   unsigned int Parser::columnCount(void) const
   {
-      return _header.size();
+      return _content->columnCount();
   }
 
   std::vector<std::string> Parser::getHeader(void) const
   {
-      return _header;
+      return _content->header();
   }
 
   const std::string Parser::getHeaderElement(unsigned int pos) const
   {
-      if (pos >= _header.size())
+      if (pos >= _content->columnCount())
         throw Error("can't return this header (doesn't exist)");
-      return _header[pos];
+      return _content->header()[pos];
+  }
+
+  const std::vector<std::string> &Parser::getColumn(unsigned int pos) const
+  {
+      if (pos >= _content->columnCount())
+        throw Error("can't return this column (doesn't exist)");
+      return _content->column(pos);
+  }
+
+  const std::vector<std::string> &Parser::getColumn(const std::string &name) const
+  {
+      int pos = _content->columnIndex(name);
+
+      if (pos < 0)
+        throw Error("can't return this column (doesn't exist)");
+      return _content->column(pos);
   }
 
   bool Parser::deleteRow(unsigned int pos)
   {
-    if (pos < _content.size())
+    return _content->eraseRow(pos);
+  }
+
+  bool Parser::addRow(unsigned int pos, const std::vector<std::string> &r)
+  {
+    return _content->insertRow(pos, r);
+  }
+
+  void Parser::sync(void) const
+  {
+    if (_type == DataType::eFILE)
     {
-      delete *(_content.begin() + pos);
-      _content.erase(_content.begin() + pos);
-      return true;
+      if (_journaled)
+        flushJournal();
+      else
+        rewrite();
     }
-    return false;
   }
 
-  bool Parser::addRow(unsigned int pos, const std::vector<std::string> &r)
+  void Parser::enableJournal(std::size_t compactAfter)
   {
-    Row *row = new Row(_header);
+    _journaled = true;
+    _compactAfter = compactAfter;
+    _changes.clear();
+    _content->record(&_changes, _sep);
+  }
 
-    for (auto it = r.begin(); it != r.end(); it++)
-      row->push(*it);
-    
-    if (pos <= _content.size())
+  static std::string journalName(const std::string &file)
+  {
+    return file + ".journal";
+  }
+
+  void Parser::rewrite(void) const
+  {
+    std::vector<char> buffer(1 << 16);
+    std::ofstream f;
+    f.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    f.open(_file, std::ios::out | std::ios::trunc);
+
+    // header
+    const std::vector<std::string> &header = _content->header();
+    unsigned int i = 0;
+    for (auto it = header.begin(); it != header.end(); it++)
     {
-      _content.insert(_content.begin() + pos, row);
-      return true;
+      f << *it;
+      if (i < header.size() - 1)
+        f << _sep;
+      else
+        f << '\n';
+      i++;
     }
-    return false;
+   
+    // rows field by field: operator<< on a Row always separates with ','
+    unsigned int columns = _content->columnCount();
+    for (unsigned int r = 0; r != _content->rowCount(); r++)
+    {
+      for (unsigned int c = 0; c != columns; c++)
+      {
+        f << _content->at(r, c);
+        if (c < columns - 1)
+          f << _sep;
+      }
+      f << '\n';
+    }
+    f.close();
+    if (!f)
+      throw Error(std::string("Failed to write ").append(_file));
+
+    // the file now holds every change
+    std::remove(journalName(_file).c_str());
+    _changes.clear();
   }
 
-  void Parser::sync(void) const
+  void Parser::flushJournal(void) const
   {
-    if (_type == DataType::eFILE)
+    if (_changes.empty())
+      return;
+
+    std::string appended;
+    std::vector<std::string> journaled;
+
+    /*
+    ** rows added at the end always follow every row a journal entry can
+    ** refer to, so they go straight to the file whatever their order
+    */
+    for (auto it = _changes.begin(); it != _changes.end(); it++)
     {
-      std::ofstream f;
-      f.open(_file, std::ios::out | std::ios::trunc);
+      if ((*it)[0] == 'A')
+        appended.append(*it, 2, std::string::npos).append(1, '\n');
+      else
+        journaled.push_back(*it);
+    }
 
-      // header
-      unsigned int i = 0;
-      for (auto it = _header.begin(); it != _header.end(); it++)
+    if (!appended.empty())
+    {
+      // make sure the first appended row starts on its own line
+      std::ifstream last(_file.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+      if (last.is_open() && last.tellg() > 0)
       {
-        f << *it;
-        if (i < _header.size() - 1)
-          f << ",";
-        else
-          f << std::endl;
-        i++;
+        last.seekg(-1, std::ios::end);
+        if (last.get() != '\n')
+          appended.insert(0, 1, '\n');
       }
-     
-      for (auto it = _content.begin(); it != _content.end(); it++)
-        f << **it << std::endl;
+      last.close();
+
+      std::ofstream f(_file.c_str(), std::ios::out | std::ios::app | std::ios::binary);
+      f.write(appended.data(), appended.size());
       f.close();
+      if (!f)
+        throw Error(std::string("Failed to write ").append(_file));
+    }
+    // the appended rows are on disk: if the journal write below fails, the
+    // next sync() must not append them a second time
+    _changes.swap(journaled);
+
+    if (!_changes.empty())
+    {
+      std::string journal;
+      for (auto it = _changes.begin(); it != _changes.end(); it++)
+        journal.append(*it).append(1, '\n');
+
+      std::ofstream f(journalName(_file).c_str(), std::ios::out | std::ios::app | std::ios::binary);
+      f.write(journal.data(), journal.size());
+      std::streamoff size = f.tellp();
+      f.close();
+      if (!f)
+        throw Error(std::string("Failed to write ").append(journalName(_file)));
+      // journaled too: a failed compaction must not log them again
+      _changes.clear();
+
+      if (size >= 0 && static_cast<std::size_t>(size) > _compactAfter)
+        rewrite();
+    }
+  }
+
+  /*
+  ** journal lines :  -,<row>  +,<row>,<fields>  =,<row>,<col>,<value>
+  **                  A,<fields>
+  */
+  void Parser::replayJournal(void)
+  {
+    std::ifstream f(journalName(_file).c_str());
+    std::string line;
+    std::vector<std::size_t> seps;
+
+    if (!f.is_open())
+      return;
+    while (readLine(f, line))
+    {
+      if (line.length() < 2)
+        continue;
+
+      scanSeparators(line.data(), line.length(), _sep, seps);
+      seps.push_back(line.length());
+
+      std::vector<std::string> fields;
+      for (std::size_t n = 0; n + 1 < seps.size(); n++)
+        fields.push_back(line.substr(seps[n] + 1, seps[n + 1] - seps[n] - 1));
+
+      char op = line[0];
+      bool ok = true;
+      if (op == 'A')
+        ok = _content->insertRow(_content->rowCount(), fields);
+      else if (fields.empty())
+        ok = false;
+      else
+      {
+        unsigned int pos = std::strtoul(fields[0].c_str(), NULL, 10);
+
+        fields.erase(fields.begin());
+        if (op == '-')
+          ok = _content->eraseRow(pos);
+        else if (op == '+')
+          ok = _content->insertRow(pos, fields);
+        else if (op == '=' && fields.size() >= 2)
+        {
+          // the value is the rest of the line, separators included
+          unsigned int col = std::strtoul(fields[0].c_str(), NULL, 10);
+          ok = pos < _content->rowCount() && col < _content->columnCount();
+          if (ok)
+            _content->set(pos, col, line.substr(seps[2] + 1));
+        }
+        else
+          ok = false;
+      }
+
+      if (!ok)
+        throw Error(std::string("corrupted journal ").append(journalName(_file)));
     }
   }
 
@@ -190,77 +654,555 @@ namespace csv {
   }
   
   /*
-  ** ROW
+  ** READER
   */
 
-  Row::Row(const std::vector<std::string> &header)
-      : _header(header) {}
+  Reader::Reader(const std::string &data, const DataType &type, char sep)
+    : _sep(sep), _stream(NULL), _content(NULL), _loaded(false), _count(0)
+  {
+      std::string line;
+      if (type == eFILE)
+      {
+        _file = data;
+        std::ifstream *ifile = new std::ifstream(_file.c_str());
+        if (!ifile->is_open())
+        {
+            delete ifile;
+            throw Error(std::string("Failed to open ").append(_file));
+        }
+        _stream = ifile;
+      }
+      else
+        _stream = new std::istringstream(data);
+
+      // first non empty line is the header
+      while (readLine(*_stream, line))
+        if (line != "")
+          break;
+      if (line == "")
+      {
+        delete _stream;
+        throw Error(std::string("No Data in ").append(type == eFILE ? _file : "pure content"));
+      }
+
+      std::stringstream ss(line);
+      std::string item;
+      std::vector<std::string> header;
+      while (std::getline(ss, item, _sep))
+          header.push_back(item);
+
+      _content = new Table(header);
+  }
 
-  Row::~Row(void) {}
+  Reader::~Reader(void)
+  {
+      delete _content;
+      delete _stream;
+  }
 
-  unsigned int Row::size(void) const
+  bool Reader::next(void)
   {
-    return _values.size();
+      while (readLine(*_stream, _line))
+      {
+          if (_line == "")
+            continue;
+
+          // fields are only copied into the table if row() asks for them
+          _loaded = false;
+          scanSeparators(_line.data(), _line.length(), _sep, _seps);
+
+          // if value(s) missing
+          if (_seps.size() + 1 != _content->columnCount())
+            throw Error("corrupted data !");
+          _count++;
+          return true;
+      }
+      return false;
   }
 
-  void Row::push(const std::string &value)
+  Row Reader::row(void) const
   {
-    _values.push_back(value);
+      if (_count == 0)
+          throw Error("can't return this row (doesn't exist)");
+      if (!_loaded)
+      {
+          _content->clear();
+          pushFields(_line, _seps, *_content);
+          _loaded = true;
+      }
+      return Row(*_content, 0);
   }
 
-  bool Row::set(const std::string &key, const std::string &value) 
+  std::string_view Reader::field(unsigned int pos) const
+  {
+      if (_count == 0 || pos >= _content->columnCount())
+          throw Error("can't return this value (doesn't exist)");
+
+      std::size_t begin = (pos == 0) ? 0 : _seps[pos - 1] + 1;
+      std::size_t end = (pos == _seps.size()) ? _line.length() : _seps[pos];
+      return std::string_view(_line.data() + begin, end - begin);
+  }
+
+  unsigned int Reader::rowCount(void) const
+  {
+      return _count;
+  }
+
+  unsigned int Reader::columnCount(void) const
+  {
+      return _content->columnCount();
+  }
+
+  std::vector<std::string> Reader::getHeader(void) const
+  {
+      return _content->header();
+  }
+
+  int Reader::columnIndex(const std::string &name) const
+  {
+      return findColumn(_content->header(), name);
+  }
+
+  /*
+  ** MAPPED PARSER
+  */
+
+  MappedParser::MappedParser(const std::string &file, char sep, unsigned int threads)
+    : _file(file), _sep(sep), _data(NULL), _size(0)
+  {
+#ifndef _WIN32
+      int fd = open(_file.c_str(), O_RDONLY);
+      if (fd < 0)
+          throw Error(std::string("Failed to open ").append(_file));
+
+      struct stat st;
+      if (fstat(fd, &st) != 0)
+      {
+          close(fd);
+          throw Error(std::string("Failed to stat ").append(_file));
+      }
+      if (st.st_size > 0)
+      {
+          void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (map == MAP_FAILED)
+          {
+              close(fd);
+              throw Error(std::string("Failed to map ").append(_file));
+          }
+          _data = static_cast<const char *>(map);
+          _size = st.st_size;
+          madvise(map, _size, MADV_SEQUENTIAL);
+      }
+      close(fd);
+#else
+      std::ifstream ifile(_file.c_str(), std::ios::in | std::ios::binary);
+      if (!ifile.is_open())
+          throw Error(std::string("Failed to open ").append(_file));
+      std::ostringstream ss;
+      ss << ifile.rdbuf();
+      _buffer = ss.str();
+      _data = _buffer.data();
+      _size = _buffer.size();
+#endif
+
+      try
+      {
+          parse(threads);
+      }
+      catch (...)
+      {
+#ifndef _WIN32
+          if (_data != NULL)
+              munmap(const_cast<char *>(_data), _size);
+#endif
+          throw;
+      }
+  }
+
+  MappedParser::~MappedParser(void)
+  {
+#ifndef _WIN32
+      if (_data != NULL)
+          munmap(const_cast<char *>(_data), _size);
+#endif
+  }
+
+  /*
+  ** parse every line of [cur, end) into fields, columns fields per line
+  */
+  static void parseRange(const char *cur, const char *end, char sep,
+                         std::size_t columns, std::vector<std::string_view> &fields)
+  {
+      std::vector<std::size_t> seps;
+
+      while (cur < end)
+      {
+          const char *eol = static_cast<const char *>(std::memchr(cur, '\n', end - cur));
+          if (eol == NULL)
+              eol = end;
+          std::string_view line = chompCR(std::string_view(cur, eol - cur));
+          cur = eol + 1;
+
+          if (line.empty())
+              continue;
+
+          std::size_t tokenStart = 0;
+
+          scanSeparators(line.data(), line.length(), sep, seps);
+          for (std::size_t n = 0; n != seps.size(); n++)
+          {
+              fields.push_back(line.substr(tokenStart, seps[n] - tokenStart));
+              tokenStart = seps[n] + 1;
+          }
+          fields.push_back(line.substr(tokenStart));
+
+          // if value(s) missing
+          if (seps.size() + 1 != columns)
+              throw Error("corrupted data !");
+      }
+  }
+
+  void MappedParser::parse(unsigned int threads)
+  {
+      const char *cur = _data;
+      const char *end = _data + _size;
+
+      // header is the first non empty line
+      while (cur < end && (*cur == '\n' || *cur == '\r'))
+          cur++;
+      if (cur == end)
+          throw Error(std::string("No Data in ").append(_file));
+
+      const char *eol = static_cast<const char *>(std::memchr(cur, '\n', end - cur));
+      if (eol == NULL)
+          eol = end;
+      std::stringstream ss{std::string(chompCR(std::string_view(cur, eol - cur)))};
+      std::string item;
+
+      while (std::getline(ss, item, _sep))
+          _header.push_back(item);
+      cur = (eol == end) ? end : eol + 1;
+
+      if (threads == 0)
+          threads = std::thread::hardware_concurrency();
+      if (threads == 0 || end - cur < static_cast<std::ptrdiff_t>(threads) * MIN_CHUNK)
+          threads = 1;
+      if (threads == 1)
+      {
+          parseRange(cur, end, _sep, _header.size(), _fields);
+          return;
+      }
+
+      /*
+      ** Split the body into byte ranges and move every boundary to just after
+      ** the next newline. Quote state never carries over a line, so each
+      ** chunk starts on a record boundary, quoted fields included.
+      */
+      std::vector<const char *> bounds(threads + 1);
+      bounds[0] = cur;
+      bounds[threads] = end;
+      for (unsigned int t = 1; t < threads; t++)
+      {
+          const char *pos = cur + (end - cur) * t / threads;
+          if (pos < bounds[t - 1])
+              pos = bounds[t - 1];
+          const char *nl = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+          bounds[t] = (nl == NULL) ? end : nl + 1;
+      }
+
+      std::vector<std::vector<std::string_view> > chunks(threads);
+      std::vector<std::exception_ptr> errors(threads);
+      std::vector<std::thread> workers;
+
+      for (unsigned int t = 0; t < threads; t++)
+      {
+          workers.push_back(std::thread([&, t]() {
+              try
+              {
+                  parseRange(bounds[t], bounds[t + 1], _sep, _header.size(), chunks[t]);
+              }
+              catch (...)
+              {
+                  errors[t] = std::current_exception();
+              }
+          }));
+      }
+      for (unsigned int t = 0; t < threads; t++)
+          workers[t].join();
+
+      // stitch the chunks back in file order
+      std::size_t total = 0;
+      for (unsigned int t = 0; t < threads; t++)
+      {
+          if (errors[t])
+              std::rethrow_exception(errors[t]);
+          total += chunks[t].size();
+      }
+      _fields.reserve(total);
+      for (unsigned int t = 0; t < threads; t++)
+          _fields.insert(_fields.end(), chunks[t].begin(), chunks[t].end());
+  }
+
+  MappedRow MappedParser::getRow(unsigned int rowPosition) const
+  {
+      if (rowPosition < rowCount())
+          return MappedRow(*this, rowPosition);
+      throw Error("can't return this row (doesn't exist)");
+  }
+
+  MappedRow MappedParser::operator[](unsigned int rowPosition) const
+  {
+      return MappedParser::getRow(rowPosition);
+  }
+
+  unsigned int MappedParser::rowCount(void) const
+  {
+      return _header.empty() ? 0 : _fields.size() / _header.size();
+  }
+
+  unsigned int MappedParser::columnCount(void) const
+  {
+      return _header.size();
+  }
+
+  std::vector<std::string> MappedParser::getHeader(void) const
+  {
+      return _header;
+  }
+
+  const std::string &MappedParser::getFileName(void) const
   {
-    std::vector<std::string>::const_iterator it;
-    int pos = 0;
+      return _file;
+  }
+
+  MappedRow::MappedRow(const MappedParser &parser, unsigned int row)
+      : _parser(&parser), _row(row) {}
+
+  unsigned int MappedRow::size(void) const
+  {
+      return _parser->_header.size();
+  }
+
+  std::string_view MappedRow::operator[](unsigned int valuePosition) const
+  {
+      if (valuePosition < size())
+          return _parser->_fields[_row * size() + valuePosition];
+      throw Error("can't return this value (doesn't exist)");
+  }
+
+  std::string_view MappedRow::operator[](const std::string &key) const
+  {
+      for (unsigned int pos = 0; pos != size(); pos++)
+      {
+          if (key == _parser->_header[pos])
+              return _parser->_fields[_row * size() + pos];
+      }
+
+      throw Error("can't return this value (doesn't exist)");
+  }
+
+  /*
+  ** position of a column by name, ignoring blanks around the header text
+  ** (the eBid exports have names like "Winning Bid "), or -1
+  */
+  int findColumn(const std::vector<std::string> &header, const std::string &name)
+  {
+      for (unsigned int pos = 0; pos != header.size(); pos++)
+      {
+          const std::string &h = header[pos];
+          std::size_t begin = h.find_first_not_of(" \t\r");
+          std::size_t end = h.find_last_not_of(" \t\r");
+
+          if (begin == std::string::npos)
+            continue;
+          if (h.compare(begin, end - begin + 1, name) == 0)
+            return pos;
+      }
+      return -1;
+  }
+
+  /*
+  ** TABLE
+  */
 
-    for (it = _header.begin(); it != _header.end(); it++)
+  Table::Table(const std::vector<std::string> &header)
+      : _header(header), _columns(header.size()), _changes(NULL), _sep(',') {}
+
+  unsigned int Table::rowCount(void) const
+  {
+    return _columns.empty() ? 0 : _columns[0].size();
+  }
+
+  unsigned int Table::columnCount(void) const
+  {
+    return _header.size();
+  }
+
+  const std::vector<std::string> &Table::header(void) const
+  {
+    return _header;
+  }
+
+  int Table::columnIndex(const std::string &key) const
+  {
+    for (unsigned int pos = 0; pos != _header.size(); pos++)
     {
-        if (key == *it)
-        {
-          _values[pos] = value;
-          return true;
-        }
-        pos++;
+        if (key == _header[pos])
+          return pos;
     }
-    return false;
+    return -1;
+  }
+
+  const std::vector<std::string> &Table::column(unsigned int col) const
+  {
+    return _columns[col];
   }
 
-  const std::string Row::operator[](unsigned int valuePosition) const
+  const std::string &Table::at(unsigned int row, unsigned int col) const
   {
-       if (valuePosition < _values.size())
-           return _values[valuePosition];
+    return _columns[col][row];
+  }
+
+  void Table::set(unsigned int row, unsigned int col, const std::string &value)
+  {
+    _columns[col][row] = value;
+    if (_changes != NULL)
+    {
+      std::ostringstream ss;
+      ss << "=" << _sep << row << _sep << col << _sep << value;
+      log(ss.str());
+    }
+  }
+
+  void Table::push(unsigned int col, const char *value, std::size_t len)
+  {
+    // extra fields of a corrupted line are counted by the caller but dropped
+    if (col < _columns.size())
+      _columns[col].emplace_back(value, len);
+  }
+
+  bool Table::insertRow(unsigned int pos, const std::vector<std::string> &values)
+  {
+    if (pos > rowCount() || values.size() != _columns.size())
+      return false;
+    if (_changes != NULL)
+    {
+      std::ostringstream ss;
+      if (pos == rowCount())
+        ss << "A";
+      else
+        ss << "+" << _sep << pos;
+      for (unsigned int col = 0; col != values.size(); col++)
+        ss << _sep << values[col];
+      log(ss.str());
+    }
+    for (unsigned int col = 0; col != _columns.size(); col++)
+      _columns[col].insert(_columns[col].begin() + pos, values[col]);
+    return true;
+  }
+
+  bool Table::eraseRow(unsigned int pos)
+  {
+    if (pos >= rowCount())
+      return false;
+    if (_changes != NULL)
+    {
+      std::ostringstream ss;
+      ss << "-" << _sep << pos;
+      log(ss.str());
+    }
+    for (unsigned int col = 0; col != _columns.size(); col++)
+      _columns[col].erase(_columns[col].begin() + pos);
+    return true;
+  }
+
+  /*
+  ** move every row of other (same header) to the end of this table
+  */
+  void Table::append(Table &other)
+  {
+    for (unsigned int col = 0; col != _columns.size(); col++)
+    {
+      std::vector<std::string> &from = other._columns[col];
+      if (_columns[col].empty())
+        _columns[col].swap(from);
+      else
+        _columns[col].insert(_columns[col].end(), std::make_move_iterator(from.begin()),
+                             std::make_move_iterator(from.end()));
+      from.clear();
+    }
+  }
+
+  void Table::record(std::vector<std::string> *changes, char sep)
+  {
+    _changes = changes;
+    _sep = sep;
+  }
+
+  void Table::log(const std::string &change) const
+  {
+    _changes->push_back(change);
+  }
+
+  void Table::clear(void)
+  {
+    for (unsigned int col = 0; col != _columns.size(); col++)
+      _columns[col].clear();
+  }
+
+  /*
+  ** ROW
+  */
+
+  Row::Row(Table &table, unsigned int row)
+      : _table(&table), _row(row) {}
+
+  unsigned int Row::size(void) const
+  {
+    return _table->columnCount();
+  }
+
+  bool Row::set(const std::string &key, const std::string &value) 
+  {
+    int pos = _table->columnIndex(key);
+
+    if (pos < 0)
+      return false;
+    _table->set(_row, pos, value);
+    return true;
+  }
+
+  const std::string &Row::operator[](unsigned int valuePosition) const
+  {
+       if (valuePosition < size())
+           return _table->at(_row, valuePosition);
        throw Error("can't return this value (doesn't exist)");
   }
 
-  const std::string Row::operator[](const std::string &key) const
+  const std::string &Row::operator[](const std::string &key) const
   {
-      std::vector<std::string>::const_iterator it;
-      int pos = 0;
+      int pos = _table->columnIndex(key);
 
-      for (it = _header.begin(); it != _header.end(); it++)
-      {
-          if (key == *it)
-              return _values[pos];
-          pos++;
-      }
+      if (pos >= 0)
+          return _table->at(_row, pos);
       
       throw Error("can't return this value (doesn't exist)");
   }
 
   std::ostream &operator<<(std::ostream &os, const Row &row)
   {
-      for (unsigned int i = 0; i != row._values.size(); i++)
-          os << row._values[i] << " | ";
+      for (unsigned int i = 0; i != row.size(); i++)
+          os << row[i] << " | ";
 
       return os;
   }
 
   std::ofstream &operator<<(std::ofstream &os, const Row &row)
   {
-    for (unsigned int i = 0; i != row._values.size(); i++)
+    for (unsigned int i = 0; i != row.size(); i++)
     {
-        os << row._values[i];
-        if (i < row._values.size() - 1)
+        os << row[i];
+        if (i < row.size() - 1)
           os << ",";
     }
     return os;
@@ -2,7 +2,10 @@
 # define    _CSVPARSER_HPP_
 
 # include <stdexcept>
+# include <istream>
+# include <cstddef>
 # include <string>
+# include <string_view>
 # include <vector>
 # include <list>
 # include <sstream>
@@ -19,38 +22,73 @@ namespace csv
         }
     };
 
+    /*
+    ** Columnar storage shared by every row of a parser : one header and one
+    ** vector of values per column, so a column scan walks contiguous memory.
+    */
+    class Table
+    {
+    	public:
+    	    Table(const std::vector<std::string> &);
+
+    	public:
+            unsigned int rowCount(void) const;
+            unsigned int columnCount(void) const;
+            const std::vector<std::string> &header(void) const;
+            int columnIndex(const std::string &) const;
+            const std::vector<std::string> &column(unsigned int) const;
+            const std::string &at(unsigned int row, unsigned int col) const;
+            void set(unsigned int row, unsigned int col, const std::string &);
+            void push(unsigned int col, const char *, std::size_t);
+            bool insertRow(unsigned int pos, const std::vector<std::string> &);
+            bool eraseRow(unsigned int pos);
+            void clear(void);
+            void append(Table &);
+            void record(std::vector<std::string> *, char sep);
+
+    	private:
+    		void log(const std::string &) const;
+
+    	private:
+    		const std::vector<std::string> _header;
+    		std::vector<std::vector<std::string> > _columns;
+    		std::vector<std::string> *_changes; // journal lines, NULL when not recording
+    		char _sep;
+    };
+
+    /*
+    ** Lightweight handle on one row of a Table
+    */
     class Row
     {
     	public:
-    	    Row(const std::vector<std::string> &);
-    	    ~Row(void);
+    	    Row(Table &, unsigned int);
 
     	public:
             unsigned int size(void) const;
-            void push(const std::string &);
             bool set(const std::string &, const std::string &); 
 
     	private:
-    		const std::vector<std::string> _header;
-    		std::vector<std::string> _values;
+    		Table *_table;
+    		unsigned int _row;
 
         public:
 
             template<typename T>
             const T getValue(unsigned int pos) const
             {
-                if (pos < _values.size())
+                if (pos < size())
                 {
                     T res;
                     std::stringstream ss;
-                    ss << _values[pos];
+                    ss << _table->at(_row, pos);
                     ss >> res;
                     return res;
                 }
                 throw Error("can't return this value (doesn't exist)");
             }
-            const std::string operator[](unsigned int) const;
-            const std::string operator[](const std::string &valueName) const;
+            const std::string &operator[](unsigned int) const;
+            const std::string &operator[](const std::string &valueName) const;
             friend std::ostream& operator<<(std::ostream& os, const Row &row);
             friend std::ofstream& operator<<(std::ofstream& os, const Row &row);
     };
@@ -60,40 +98,228 @@ namespace csv
         ePURE = 1
     };
 
+    /*
+    ** By default sync() rewrites the whole file. After enableJournal(), sync()
+    ** only writes what changed since the last sync : rows added at the end
+    ** are appended to the file, any other insert, delete or update is
+    ** appended to "<file>.journal", and the file is rewritten (compacted)
+    ** once the journal grows past compactAfter bytes. A journal left next
+    ** to the file is replayed when the file is opened.
+    **
+    ** With threads != 1 the rows are split on that many threads (0 uses
+    ** every hardware thread), each filling its own table over a contiguous
+    ** range of lines; the tables are appended back in file order.
+    */
     class Parser
     {
 
     public:
-        Parser(const std::string &, const DataType &type = eFILE, char sep = ',');
+        Parser(const std::string &, const DataType &type = eFILE, char sep = ',',
+               unsigned int threads = 1);
         ~Parser(void);
 
     public:
-        Row &getRow(unsigned int row) const;
+        Row getRow(unsigned int row) const;
         unsigned int rowCount(void) const;
         unsigned int columnCount(void) const;
         std::vector<std::string> getHeader(void) const;
         const std::string getHeaderElement(unsigned int pos) const;
+        const std::vector<std::string> &getColumn(unsigned int pos) const;
+        const std::vector<std::string> &getColumn(const std::string &name) const;
         const std::string &getFileName(void) const;
 
     public:
         bool deleteRow(unsigned int row);
         bool addRow(unsigned int pos, const std::vector<std::string> &);
         void sync(void) const;
+        void enableJournal(std::size_t compactAfter = DEFAULT_JOURNAL_LIMIT);
+
+    public:
+        static const std::size_t DEFAULT_JOURNAL_LIMIT = 256 * 1024;
+        static const std::size_t MIN_CHUNK_ROWS = 2048; // smaller inputs stay serial
 
     protected:
     	void parseHeader(void);
-    	void parseContent(void);
+    	void parseContent(unsigned int threads);
+    	void replayJournal(void);
+    	void rewrite(void) const;
+    	void flushJournal(void) const;
+
+    private:
+        Parser(const Parser &);
+        Parser &operator=(const Parser &);
 
     private:
         std::string _file;
         const DataType _type;
         const char _sep;
         std::vector<std::string> _originalFile;
+        Table *_content;
+        mutable std::vector<std::string> _changes;
+        bool _journaled;
+        std::size_t _compactAfter;
+
+    public:
+        Row operator[](unsigned int row) const;
+    };
+
+    /*
+    ** Streaming reader : parses and hands out one row at a time instead of
+    ** loading the whole file up front, so memory stays bounded by one line.
+    ** The row returned by row() is reused and only valid until next().
+    ** field() gives a view of one value of the current line without copying.
+    */
+    class Reader
+    {
+
+    public:
+        Reader(const std::string &, const DataType &type = eFILE, char sep = ',');
+        ~Reader(void);
+
+    public:
+        bool next(void);
+        Row row(void) const;
+        std::string_view field(unsigned int) const;
+        unsigned int rowCount(void) const;
+        unsigned int columnCount(void) const;
+        std::vector<std::string> getHeader(void) const;
+        int columnIndex(const std::string &) const;
+
+    private:
+        Reader(const Reader &);
+        Reader &operator=(const Reader &);
+
+    private:
+        std::string _file;
+        const char _sep;
+        std::istream *_stream;
+        Table *_content;
+        std::string _line;
+        std::vector<std::size_t> _seps;
+        mutable bool _loaded;
+        unsigned int _count;
+    };
+
+    /*
+    ** Typed binding of a record to named columns. A schema is a constant
+    ** array of fields, each a header name and a function storing the value
+    ** into the record :
+    **
+    **   static constexpr csv::Field<Bid> BID_SCHEMA[] = {
+    **       { "Auction ID", [](Bid &b, std::string_view v) { b.bidId.assign(v); } },
+    **       { "Winning Bid", [](Bid &b, std::string_view v) { b.amount = csv::parseCurrency(v); } },
+    **   };
+    **
+    ** A name may list alternatives separated by '|' ("Auction ID|ArticleID")
+    ** for exports that label the same column differently. Names are resolved
+    ** against the reader header once, then bind() only touches the projected
+    ** columns of each line. Values are handed over with their CSV quoting
+    ** removed ("""ASE"" File Cabinet" arrives as "ASE" File Cabinet).
+    */
+    int findColumn(const std::vector<std::string> &header, const std::string &name);
+    double parseCurrency(std::string_view);
+    std::string_view unquote(std::string_view, std::string &scratch);
+
+    template<typename Record>
+    struct Field
+    {
+        const char *name;
+        void (*assign)(Record &, std::string_view);
+    };
+
+    template<typename Record>
+    class Schema
+    {
+
+    public:
+        template<std::size_t N>
+        Schema(const Field<Record> (&fields)[N], const Reader &reader)
+        {
+            for (std::size_t i = 0; i != N; i++)
+            {
+                std::stringstream names(fields[i].name);
+                std::string name;
+                int pos = -1;
+
+                while (pos < 0 && std::getline(names, name, '|'))
+                    pos = reader.columnIndex(name);
+                if (pos < 0)
+                    throw Error(std::string("unknown column ").append(fields[i].name));
+                _columns.push_back(pos);
+                _assign.push_back(fields[i].assign);
+            }
+        }
+
+        void bind(const Reader &reader, Record &record) const
+        {
+            std::string scratch;
+            for (std::size_t i = 0; i != _columns.size(); i++)
+                _assign[i](record, unquote(reader.field(_columns[i]), scratch));
+        }
+
+    private:
+        std::vector<unsigned int> _columns;
+        std::vector<void (*)(Record &, std::string_view)> _assign;
+    };
+
+    /*
+    ** Memory mapped parser : the file is mapped read-only and every field is a
+    ** std::string_view into the mapping, so loading allocates one offset table
+    ** instead of a string per field. Views stay valid while the parser lives.
+    ** With threads != 1 the body is parsed in parallel byte ranges (0 uses
+    ** every hardware thread) and the rows keep their file order.
+    */
+    class MappedParser;
+
+    class MappedRow
+    {
+    	public:
+    	    MappedRow(const MappedParser &, unsigned int);
+
+    	public:
+            unsigned int size(void) const;
+            std::string_view operator[](unsigned int) const;
+            std::string_view operator[](const std::string &valueName) const;
+
+    	private:
+    		const MappedParser *_parser;
+    		unsigned int _row;
+    };
+
+    class MappedParser
+    {
+
+    public:
+        MappedParser(const std::string &, char sep = ',', unsigned int threads = 1);
+        ~MappedParser(void);
+
+    public:
+        MappedRow getRow(unsigned int row) const;
+        unsigned int rowCount(void) const;
+        unsigned int columnCount(void) const;
+        std::vector<std::string> getHeader(void) const;
+        const std::string &getFileName(void) const;
+
+    private:
+        MappedParser(const MappedParser &);
+        MappedParser &operator=(const MappedParser &);
+        void parse(unsigned int threads);
+
+    private:
+        friend class MappedRow;
+
+        static const std::ptrdiff_t MIN_CHUNK = 64 * 1024; // smaller inputs stay serial
+
+        std::string _file;
+        const char _sep;
+        const char *_data;
+        std::size_t _size;
+        std::string _buffer; // used when mapping is not available
         std::vector<std::string> _header;
-        std::vector<Row *> _content;
+        std::vector<std::string_view> _fields; // row major, columnCount() per row
 
     public:
-        Row &operator[](unsigned int row) const;
+        MappedRow operator[](unsigned int row) const;
     };
 }
 
@@ -1,12 +1,33 @@
+#include <atomic>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "BidIndex.hpp"
 #include "CSVparser.hpp"
+#include "NodePool.hpp"
+#include "OutputSink.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 using namespace std;
 
 /*
     HashTable.cpp
     Implementation of a hash table using chaining with singly linked lists.
+    The table grows once the load factor passes MAX_LOAD_FACTOR, moving a
+    few buckets per operation instead of rehashing everything at once. The
+    hash function is a policy parameter so alternatives can be compared on
+    real data with Stats()/PrintStats().
 */
 
 struct Node {
@@ -14,93 +35,365 @@ struct Node {
     Node* next;
 
     Node() : next(nullptr) {}
-    Node(Bid aBid) : bid(aBid), next(nullptr) {}
+    Node(Bid aBid) : bid(std::move(aBid)), next(nullptr) {}
 };
 
-class HashTable {
+/* One PrintAll record; text format is "Key i: id | title | amount | fund" */
+static void writeBid(out::Sink& sink, unsigned int key, const Bid& bid) {
+    sink.Begin();
+    sink.Integer("key", key, "Key ");
+    sink.Field("bidId", bid.bidId, ": ");
+    sink.Field("title", bid.title, " | ");
+    sink.Money("amount", bid.amount, " | ");
+    sink.Field("fund", bid.fund, " | ");
+    sink.End();
+}
+
+/*
+    Hash policies for BasicHashTable. Each one maps a key to a 64-bit hash
+    that the table reduces modulo its bucket count.
+*/
+
+/* djb2: hash * 33 + c, one byte at a time */
+struct Djb2Hash {
+    static const char* Name() { return "djb2"; }
+    unsigned long long operator()(string_view key) const {
+        unsigned long long hash = 5381;
+        for (char c : key) {
+            hash = ((hash << 5) + hash) + c; // hash * 33 + c
+        }
+        return hash;
+    }
+};
+
+/* FNV-1a: xor then multiply, one byte at a time */
+struct Fnv1aHash {
+    static const char* Name() { return "fnv-1a"; }
+    unsigned long long operator()(string_view key) const {
+        unsigned long long hash = 14695981039346656037ULL;
+        for (char c : key) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+/* Wide-word hash in the style of wyhash: eats 8 bytes per step and mixes
+   with a 64x64 -> 128 bit multiply */
+struct WideHash {
+    static const char* Name() { return "wide"; }
+
+    static unsigned long long Mix(unsigned long long a, unsigned long long b) {
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        return static_cast<unsigned long long>(product) ^ static_cast<unsigned long long>(product >> 64);
+#else
+        unsigned long long product = a * b;
+        return product ^ (product >> 29) ^ ((a ^ (a >> 32)) * (b | 1));
+#endif
+    }
+
+    unsigned long long operator()(string_view key) const {
+        const unsigned long long P0 = 0xa0761d6478bd642fULL;
+        const unsigned long long P1 = 0xe7037ed1a0b428dbULL;
+        unsigned long long hash = P0 ^ key.size();
+        size_t i = 0;
+
+        for (; i + 8 <= key.size(); i += 8) {
+            unsigned long long word;
+            memcpy(&word, key.data() + i, 8);
+            hash = Mix(hash ^ word, P1);
+        }
+        unsigned long long tail = 0;
+        memcpy(&tail, key.data() + i, key.size() - i);
+        return Mix(hash ^ tail, P1 ^ key.size());
+    }
+};
+
+/* Bucket distribution reported by BasicHashTable::Stats */
+struct HashStats {
+    static const unsigned int HISTOGRAM_BINS = 8; // last bin counts chains of 7 or more
+
+    unsigned int buckets;
+    unsigned int size;
+    double loadFactor;
+    unsigned int emptyBuckets;
+    unsigned int maxChain;       // longest chain = most nodes a lookup can probe
+    unsigned int collisions;     // bids that share a bucket with an earlier bid
+    vector<unsigned int> histogram; // histogram[n] = buckets holding n bids
+};
+
+template<typename HashPolicy>
+class BasicHashTable {
 private:
     static const unsigned int DEFAULT_SIZE = 179; // prime table size to reduce collisions
+    static const unsigned int MIGRATE_BUCKETS = 8; // old buckets moved per operation while growing
+    static constexpr double MAX_LOAD_FACTOR = 1.0; // average chain length that triggers growth
+
     Node** table;  // array of linked list heads
     unsigned int tableSize;
+    Node** newTable;  // table being grown into, nullptr when not resizing
+    unsigned int newTableSize;
+    unsigned int migrated;  // old buckets [0, migrated) have moved to newTable
+    unsigned int size;
+    NodePool<Node> pool;  // chain nodes, freed together in FreeTable
+    HashPolicy hasher;
+    BidIndex<Bid> index;  // fund and amount indexes, built by the first Query
+    bool indexed;
 
-    unsigned int Hash(string key);
+    unsigned long long Hash(string_view key) const;
+    Node** Bucket(unsigned long long hash);
+    void StartResize(unsigned int buckets);
+    void RehashStep(unsigned int buckets);
+    static unsigned int NextPrime(unsigned int n);
     void FreeTable();
 
 public:
-    HashTable();
-    virtual ~HashTable();
+    BasicHashTable();
+    virtual ~BasicHashTable();
 
     void Insert(Bid bid);
-    void PrintAll();
+    void BulkLoad(vector<Bid>&& bids, unsigned int threads = 1);
+    void PrintAll(out::Sink& sink = out::Console());
     void Remove(string bidId);
     Bid Search(string bidId);
+    const Bid* Find(string_view bidId);
+    vector<const Bid*> Query(string_view fund, double minAmount, double maxAmount);
+    unsigned int Size();
+    double LoadFactor();
+    HashStats Stats();
+    void PrintStats();
 };
 
+/* The table used by the bid programs: djb2, as it always was */
+typedef BasicHashTable<Djb2Hash> HashTable;
+
 /* Constructor: initialize hash table */
-HashTable::HashTable() {
+template<typename HashPolicy>
+BasicHashTable<HashPolicy>::BasicHashTable() {
     tableSize = DEFAULT_SIZE;
     table = new Node * [tableSize];
     for (unsigned int i = 0; i < tableSize; ++i) {
         table[i] = nullptr;
     }
+    newTable = nullptr;
+    newTableSize = 0;
+    migrated = 0;
+    size = 0;
+    indexed = false;
 }
 
 /* Destructor: free memory */
-HashTable::~HashTable() {
+template<typename HashPolicy>
+BasicHashTable<HashPolicy>::~BasicHashTable() {
     FreeTable();
 }
 
-/* Simple string hash function (djb2 variation) */
-unsigned int HashTable::Hash(string key) {
-    unsigned long hash = 5381;
-    for (char c : key) {
-        hash = ((hash << 5) + hash) + c; // hash * 33 + c
+/* Full hash of a key from the policy, reduced per table by Bucket */
+template<typename HashPolicy>
+unsigned long long BasicHashTable<HashPolicy>::Hash(string_view key) const {
+    return hasher(key);
+}
+
+/*
+    Head of the chain a hash belongs to. While growing, old buckets below
+    migrated have already been moved, so their keys live in newTable.
+*/
+template<typename HashPolicy>
+Node** BasicHashTable<HashPolicy>::Bucket(unsigned long long hash) {
+    unsigned int key = static_cast<unsigned int>(hash % tableSize);
+    if (newTable != nullptr && key < migrated) {
+        return &newTable[hash % newTableSize];
+    }
+    return &table[key];
+}
+
+/* Smallest prime >= n */
+template<typename HashPolicy>
+unsigned int BasicHashTable<HashPolicy>::NextPrime(unsigned int n) {
+    if (n <= 2) return 2;
+    if (n % 2 == 0) ++n;
+    for (;; n += 2) {
+        bool prime = true;
+        for (unsigned int d = 3; d * d <= n; d += 2) {
+            if (n % d == 0) {
+                prime = false;
+                break;
+            }
+        }
+        if (prime) return n;
+    }
+}
+
+/* Allocate a table of at least `buckets` buckets; buckets move over in RehashStep */
+template<typename HashPolicy>
+void BasicHashTable<HashPolicy>::StartResize(unsigned int buckets) {
+    newTableSize = NextPrime(buckets);
+    newTable = new Node * [newTableSize];
+    for (unsigned int i = 0; i < newTableSize; ++i) {
+        newTable[i] = nullptr;
+    }
+    migrated = 0;
+}
+
+/*
+    Move up to `buckets` old buckets into the new table. Spreading the move
+    over many operations keeps any single Insert from paying for a full
+    rehash; once every bucket has moved the new table replaces the old one.
+*/
+template<typename HashPolicy>
+void BasicHashTable<HashPolicy>::RehashStep(unsigned int buckets) {
+    if (newTable == nullptr) return;
+
+    for (unsigned int n = 0; n < buckets && migrated < tableSize; ++n, ++migrated) {
+        Node* current = table[migrated];
+        while (current != nullptr) {
+            Node* next = current->next;
+            Node** head = &newTable[Hash(current->bid.bidId) % newTableSize];
+            current->next = *head;
+            *head = current;
+            current = next;
+        }
+        table[migrated] = nullptr;
+    }
+
+    if (migrated == tableSize) {
+        delete[] table;
+        table = newTable;
+        tableSize = newTableSize;
+        newTable = nullptr;
+        newTableSize = 0;
+        migrated = 0;
     }
-    return static_cast<unsigned int>(hash % tableSize);
 }
 
 /* Insert a bid into the hash table */
-void HashTable::Insert(Bid bid) {
-    unsigned int key = Hash(bid.bidId);
-    Node* newNode = new Node(bid);
+template<typename HashPolicy>
+void BasicHashTable<HashPolicy>::Insert(Bid bid) {
+    RehashStep(MIGRATE_BUCKETS);
+    if (newTable == nullptr && size + 1 > tableSize * MAX_LOAD_FACTOR) {
+        StartResize(tableSize * 2 + 1);
+    }
+
+    Node** head = Bucket(Hash(bid.bidId));
+    Node* newNode = pool.New(std::move(bid));
 
-    if (table[key] == nullptr) {
-        table[key] = newNode;
+    if (*head == nullptr) {
+        *head = newNode;
     } else {
-        newNode->next = table[key];
-        table[key] = newNode;
+        newNode->next = *head;
+        *head = newNode;
+    }
+    ++size;
+    if (indexed) {
+        index.Add(&newNode->bid);
     }
 }
 
+/*
+    Load a whole batch of bids at once. The table is sized for the final
+    count up front, every key is hashed in one pass (split over `threads`
+    threads for large batches), and the nodes are then created bucket by
+    bucket so each chain sits contiguously in the pool. Bids are moved out
+    of `bids`, which is left empty.
+*/
+template<typename HashPolicy>
+void BasicHashTable<HashPolicy>::BulkLoad(vector<Bid>&& bids, unsigned int threads) {
+    const size_t count = bids.size();
+    if (count == 0) return;
+
+    // finish any resize, then grow once to the final size
+    RehashStep(tableSize);
+    unsigned int needed = static_cast<unsigned int>((size + count) / MAX_LOAD_FACTOR) + 1;
+    if (needed > tableSize) {
+        StartResize(needed);
+        RehashStep(tableSize);
+    }
+
+    // bucket of every bid
+    vector<unsigned int> buckets(count);
+    auto hashRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            buckets[i] = static_cast<unsigned int>(Hash(bids[i].bidId) % tableSize);
+        }
+    };
+    if (threads <= 1 || count < 16384) {
+        hashRange(0, count);
+    } else {
+        vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads; ++t) {
+            workers.emplace_back(hashRange, count * t / threads, count * (t + 1) / threads);
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // counting sort of the bids by bucket
+    vector<unsigned int> start(tableSize + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++start[buckets[i] + 1];
+    }
+    for (unsigned int b = 0; b < tableSize; ++b) {
+        start[b + 1] += start[b];
+    }
+    vector<unsigned int> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[start[buckets[i]]++] = static_cast<unsigned int>(i);
+    }
+
+    // build the chains in bucket order, pushing onto any existing chain
+    for (size_t n = 0; n < count; ++n) {
+        size_t i = order[n];
+        Node* node = pool.New(std::move(bids[i]));
+        node->next = table[buckets[i]];
+        table[buckets[i]] = node;
+        if (indexed) {
+            index.Add(&node->bid);
+        }
+    }
+    size += static_cast<unsigned int>(count);
+    bids.clear();
+}
+
 /* Display all bids (bucket order) */
-void HashTable::PrintAll() {
+template<typename HashPolicy>
+void BasicHashTable<HashPolicy>::PrintAll(out::Sink& sink) {
+    // finish any resize so every bid is in one table
+    RehashStep(tableSize);
+
     for (unsigned int i = 0; i < tableSize; ++i) {
         Node* current = table[i];
         while (current != nullptr) {
-            cout << "Key " << i << ": "
-                << current->bid.bidId << " | "
-                << current->bid.title << " | "
-                << fixed << setprecision(2) << current->bid.amount
-                << " | " << current->bid.fund << endl;
+            writeBid(sink, i, current->bid);
             current = current->next;
         }
     }
+    sink.Flush();
 }
 
 /* Remove a bid by ID */
-void HashTable::Remove(string bidId) {
-    unsigned int key = Hash(bidId);
-    Node* current = table[key];
+template<typename HashPolicy>
+void BasicHashTable<HashPolicy>::Remove(string bidId) {
+    RehashStep(MIGRATE_BUCKETS);
+
+    Node** head = Bucket(Hash(bidId));
+    Node* current = *head;
     Node* previous = nullptr;
 
     while (current != nullptr) {
         if (current->bid.bidId == bidId) {
             if (previous == nullptr) {
-                table[key] = current->next;
+                *head = current->next;
             } else {
                 previous->next = current->next;
             }
-            delete current;
+            if (indexed) {
+                index.Remove(&current->bid);
+            }
+            pool.Delete(current);
+            --size;
             return;
         }
         previous = current;
@@ -108,31 +401,663 @@ void HashTable::Remove(string bidId) {
     }
 }
 
-/* Search for a bid by ID */
-Bid HashTable::Search(string bidId) {
-    unsigned int key = Hash(bidId);
-    Node* current = table[key];
+/* Search for a bid by ID, returning a copy (empty bid if not found) */
+template<typename HashPolicy>
+Bid BasicHashTable<HashPolicy>::Search(string bidId) {
+    const Bid* bid = Find(bidId);
+    if (bid != nullptr) {
+        return *bid;
+    }
+    Bid emptyBid;
+    return emptyBid; // not found
+}
+
+/* Find a bid by ID without copying; nullptr if not found. The pointer is
+   valid until the bid is removed or the table is destroyed. */
+template<typename HashPolicy>
+const Bid* BasicHashTable<HashPolicy>::Find(string_view bidId) {
+    RehashStep(MIGRATE_BUCKETS);
+
+    Node* current = *Bucket(Hash(bidId));
 
     while (current != nullptr) {
         if (current->bid.bidId == bidId) {
-            return current->bid;
+            return &current->bid;
         }
         current = current->next;
     }
+    return nullptr;
+}
+
+/*
+    Bids of `fund` (any fund if empty) with minAmount <= amount <= maxAmount.
+    The first call indexes every bid by fund and amount; Insert, BulkLoad and
+    Remove keep the indexes up to date after that, so a query only touches
+    the bids it returns. Pointers stay valid until the bid is removed.
+*/
+template<typename HashPolicy>
+vector<const Bid*> BasicHashTable<HashPolicy>::Query(string_view fund, double minAmount, double maxAmount) {
+    if (!indexed) {
+        // nodes never move in the pool, so rehashing leaves the pointers valid
+        RehashStep(tableSize);
+        for (unsigned int i = 0; i < tableSize; ++i) {
+            for (Node* current = table[i]; current != nullptr; current = current->next) {
+                index.Add(&current->bid);
+            }
+        }
+        indexed = true;
+    }
+    return index.Query(fund, minAmount, maxAmount);
+}
+
+/* Number of bids stored */
+template<typename HashPolicy>
+unsigned int BasicHashTable<HashPolicy>::Size() {
+    return size;
+}
+
+/* Average chain length (bids per bucket) */
+template<typename HashPolicy>
+double BasicHashTable<HashPolicy>::LoadFactor() {
+    if (newTable != nullptr) {
+        return static_cast<double>(size) / newTableSize;
+    }
+    return static_cast<double>(size) / tableSize;
+}
+
+/* Bucket distribution of the bids currently loaded */
+template<typename HashPolicy>
+HashStats BasicHashTable<HashPolicy>::Stats() {
+    // finish any resize so every bid is in one table
+    RehashStep(tableSize);
+
+    HashStats stats;
+    stats.buckets = tableSize;
+    stats.size = size;
+    stats.loadFactor = static_cast<double>(size) / tableSize;
+    stats.emptyBuckets = 0;
+    stats.maxChain = 0;
+    stats.histogram.assign(HashStats::HISTOGRAM_BINS, 0);
+
+    for (unsigned int i = 0; i < tableSize; ++i) {
+        unsigned int length = 0;
+        for (Node* current = table[i]; current != nullptr; current = current->next) {
+            ++length;
+        }
+        if (length == 0) ++stats.emptyBuckets;
+        if (length > stats.maxChain) stats.maxChain = length;
+        ++stats.histogram[length < HashStats::HISTOGRAM_BINS ? length : HashStats::HISTOGRAM_BINS - 1];
+    }
+    // every bid after the first in a bucket collided with it
+    stats.collisions = size - (tableSize - stats.emptyBuckets);
+    return stats;
+}
+
+/* Print Stats() in a readable form */
+template<typename HashPolicy>
+void BasicHashTable<HashPolicy>::PrintStats() {
+    HashStats stats = Stats();
+
+    // format the load factor on its own so cout keeps its flags and precision
+    ostringstream loadFactor;
+    loadFactor << fixed << setprecision(2) << stats.loadFactor;
+
+    cout << "Hash: " << HashPolicy::Name() << endl;
+    cout << "Buckets: " << stats.buckets << " | Bids: " << stats.size
+        << " | Load factor: " << loadFactor.str() << endl;
+    cout << "Empty buckets: " << stats.emptyBuckets
+        << " | Collisions: " << stats.collisions
+        << " | Longest chain: " << stats.maxChain << endl;
+    for (unsigned int i = 0; i < HashStats::HISTOGRAM_BINS; ++i) {
+        cout << "  chain " << i << (i + 1 == HashStats::HISTOGRAM_BINS ? "+" : "")
+            << ": " << stats.histogram[i] << " buckets" << endl;
+    }
+}
+
+/* Free memory for all nodes: the pool drops them without walking the chains */
+template<typename HashPolicy>
+void BasicHashTable<HashPolicy>::FreeTable() {
+    index.Clear();
+    indexed = false;
+    pool.Clear();
+    delete[] table;
+    delete[] newTable;
+    table = newTable = nullptr;
+}
+
+/*
+    FlatHashTable
+    Open addressing alternative to HashTable (Swiss table layout). Bids are
+    stored inline in one slot array and a parallel array of one control byte
+    per slot says whether the slot is empty, deleted, or full; a full slot
+    keeps 7 bits of the key's hash. Slots are probed a group of 16 at a
+    time: the 16 control bytes are compared against the hash bits in one
+    SSE2 instruction, so a lookup usually touches one control group and the
+    one matching slot. Inserting an existing bidId replaces that bid.
+*/
+/* Index of the lowest set bit of a non-zero mask */
+static unsigned int countTrailingZeros(unsigned int mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned int>(index);
+#else
+    unsigned int index = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+class FlatHashTable {
+private:
+    static const unsigned int GROUP_SIZE = 16;
+    static const unsigned int DEFAULT_CAPACITY = 256; // power of two, multiple of GROUP_SIZE
+    static const signed char EMPTY = -128;            // 0b10000000
+    static const signed char DELETED = -2;            // 0b11111110
+
+    signed char* control; // one control byte per slot
+    Bid* slots;
+    unsigned int capacity;
+    unsigned int size;
+    unsigned int growthLeft; // inserts left before the table must be rehashed
+
+    static unsigned long long HashKey(string_view key);
+    unsigned int MatchGroup(unsigned int group, signed char tag) const;
+    unsigned int FindSlot(string_view bidId) const;
+    void Allocate(unsigned int newCapacity);
+    void Rehash(unsigned int newCapacity);
+    void InsertNew(Bid&& bid, unsigned long long hash);
+
+public:
+    FlatHashTable();
+    virtual ~FlatHashTable();
+
+    void Insert(const Bid& bid);
+    void Insert(Bid&& bid);
+    void PrintAll(out::Sink& sink = out::Console());
+    void Remove(string bidId);
+    Bid Search(string bidId);
+    const Bid* Find(string_view bidId) const;
+    unsigned int Size();
+};
+
+/* Constructor: start with DEFAULT_CAPACITY empty slots */
+FlatHashTable::FlatHashTable() {
+    Allocate(DEFAULT_CAPACITY);
+}
+
+/* Destructor: free the slot and control arrays */
+FlatHashTable::~FlatHashTable() {
+    delete[] control;
+    delete[] slots;
+}
+
+/* djb2 (as in HashTable) followed by a multiply/xor-shift mix so both the
+   low 7 bits and the group index bits are well distributed */
+unsigned long long FlatHashTable::HashKey(string_view key) {
+    unsigned long long hash = 5381;
+    for (char c : key) {
+        hash = ((hash << 5) + hash) + c; // hash * 33 + c
+    }
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 32);
+}
+
+/* Bitmask of the slots in a group whose control byte equals tag */
+unsigned int FlatHashTable::MatchGroup(unsigned int group, signed char tag) const {
+    const signed char* bytes = control + group * GROUP_SIZE;
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    return static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag))));
+#else
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < GROUP_SIZE; ++i) {
+        if (bytes[i] == tag) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/* Slot index holding bidId, or capacity if it is not in the table */
+unsigned int FlatHashTable::FindSlot(string_view bidId) const {
+    unsigned long long hash = HashKey(bidId);
+    signed char tag = static_cast<signed char>(hash & 0x7F);
+    unsigned int groups = capacity / GROUP_SIZE;
+    unsigned int group = static_cast<unsigned int>(hash >> 7) & (groups - 1);
+
+    // triangular probing over groups visits every group once
+    for (unsigned int step = 1; step <= groups; ++step) {
+        unsigned int match = MatchGroup(group, tag);
+        while (match != 0) {
+            unsigned int slot = group * GROUP_SIZE + countTrailingZeros(match);
+            if (slots[slot].bidId == bidId) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+        // an empty slot ends the probe: the key would have been placed here
+        if (MatchGroup(group, EMPTY) != 0) {
+            break;
+        }
+        group = (group + step) & (groups - 1);
+    }
+    return capacity;
+}
+
+/* Allocate newCapacity empty slots (the old arrays must already be released) */
+void FlatHashTable::Allocate(unsigned int newCapacity) {
+    capacity = newCapacity;
+    control = new signed char[capacity];
+    slots = new Bid[capacity];
+    for (unsigned int i = 0; i < capacity; ++i) {
+        control[i] = EMPTY;
+    }
+    size = 0;
+    growthLeft = capacity - capacity / 8; // keep the load factor at or under 7/8
+}
+
+/* Move every bid into a fresh table of newCapacity slots, dropping tombstones */
+void FlatHashTable::Rehash(unsigned int newCapacity) {
+    signed char* oldControl = control;
+    Bid* oldSlots = slots;
+    unsigned int oldCapacity = capacity;
+
+    Allocate(newCapacity);
+    for (unsigned int i = 0; i < oldCapacity; ++i) {
+        if (oldControl[i] >= 0) {
+            unsigned long long hash = HashKey(oldSlots[i].bidId);
+            InsertNew(std::move(oldSlots[i]), hash);
+        }
+    }
+    delete[] oldControl;
+    delete[] oldSlots;
+}
+
+/* Place a bid known not to be in the table in the first free slot of its probe */
+void FlatHashTable::InsertNew(Bid&& bid, unsigned long long hash) {
+    unsigned int groups = capacity / GROUP_SIZE;
+    unsigned int group = static_cast<unsigned int>(hash >> 7) & (groups - 1);
+
+    for (unsigned int step = 1; ; ++step) {
+        unsigned int free = MatchGroup(group, EMPTY) | MatchGroup(group, DELETED);
+        if (free != 0) {
+            unsigned int slot = group * GROUP_SIZE + countTrailingZeros(free);
+            if (control[slot] == EMPTY) {
+                --growthLeft;
+            }
+            control[slot] = static_cast<signed char>(hash & 0x7F);
+            slots[slot] = std::move(bid);
+            ++size;
+            return;
+        }
+        group = (group + step) & (groups - 1);
+    }
+}
+
+/* Insert a copy of a bid, replacing any bid with the same id */
+void FlatHashTable::Insert(const Bid& bid) {
+    Insert(Bid(bid));
+}
+
+/* Insert a bid by moving it into its slot, replacing any bid with the same id */
+void FlatHashTable::Insert(Bid&& bid) {
+    unsigned int slot = FindSlot(bid.bidId);
+    if (slot != capacity) {
+        slots[slot] = std::move(bid);
+        return;
+    }
+
+    if (growthLeft == 0) {
+        // mostly tombstones: clean up in place, otherwise double
+        Rehash(size < capacity / 2 ? capacity : capacity * 2);
+    }
+    unsigned long long hash = HashKey(bid.bidId);
+    InsertNew(std::move(bid), hash);
+}
+
+/* Display all bids (slot order) */
+void FlatHashTable::PrintAll(out::Sink& sink) {
+    for (unsigned int i = 0; i < capacity; ++i) {
+        if (control[i] >= 0) {
+            writeBid(sink, i, slots[i]);
+        }
+    }
+    sink.Flush();
+}
+
+/* Remove a bid by ID */
+void FlatHashTable::Remove(string bidId) {
+    unsigned int slot = FindSlot(bidId);
+    if (slot == capacity) {
+        return;
+    }
+
+    // a group that still has an empty slot was never full, so no probe ever
+    // went past it and the slot can go back to empty instead of a tombstone
+    unsigned int group = slot / GROUP_SIZE;
+    if (MatchGroup(group, EMPTY) != 0) {
+        control[slot] = EMPTY;
+        ++growthLeft;
+    } else {
+        control[slot] = DELETED;
+    }
+    slots[slot] = Bid();
+    --size;
+}
+
+/* Search for a bid by ID, returning a copy (empty bid if not found) */
+Bid FlatHashTable::Search(string bidId) {
+    const Bid* bid = Find(bidId);
+    if (bid != nullptr) {
+        return *bid;
+    }
     Bid emptyBid;
     return emptyBid; // not found
 }
 
-/* Free memory for all nodes */
-void HashTable::FreeTable() {
+/* Find a bid by ID without copying; nullptr if not found. The pointer is
+   valid until the next Insert or Remove. */
+const Bid* FlatHashTable::Find(string_view bidId) const {
+    unsigned int slot = FindSlot(bidId);
+    return slot != capacity ? &slots[slot] : nullptr;
+}
+
+/* Number of bids stored */
+unsigned int FlatHashTable::Size() {
+    return size;
+}
+
+/*
+    EpochDomain
+    Epoch based reclamation for lock-free readers. A reader announces the
+    global epoch it started in; memory unlinked by a writer is retired with
+    the epoch of the unlink and only freed once the global epoch has moved
+    two steps past it, which can only happen after every reader that might
+    still hold a pointer to it has left.
+*/
+class EpochDomain {
+private:
+    static const unsigned int MAX_THREADS = 256;
+    static const unsigned int RETIRE_BATCH = 64; // retired objects before trying to free
+
+    struct alignas(64) Slot {
+        std::atomic<bool> owned;
+        std::atomic<unsigned long long> epoch; // 0 when outside a read, else epoch + 1
+    };
+
+    struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+        unsigned long long epoch;
+    };
+
+    Slot slots[MAX_THREADS];
+    std::atomic<unsigned long long> globalEpoch;
+    std::mutex retireLock;
+    std::vector<Retired> retired;
+
+    EpochDomain();
+    unsigned int SlotIndex();
+    void TryAdvance();
+
+public:
+    ~EpochDomain();
+    static EpochDomain& Instance();
+
+    void Enter();
+    void Exit();
+    void Retire(void* ptr, void (*deleter)(void*));
+};
+
+EpochDomain::EpochDomain() : globalEpoch(1) {
+    for (unsigned int i = 0; i < MAX_THREADS; ++i) {
+        slots[i].owned.store(false);
+        slots[i].epoch.store(0);
+    }
+}
+
+/* At exit no reader is left, so everything retired can go */
+EpochDomain::~EpochDomain() {
+    for (const Retired& r : retired) {
+        r.deleter(r.ptr);
+    }
+}
+
+EpochDomain& EpochDomain::Instance() {
+    static EpochDomain domain;
+    return domain;
+}
+
+/* Slot owned by the calling thread, claimed on first use and freed at thread exit */
+unsigned int EpochDomain::SlotIndex() {
+    struct Holder {
+        int index = -1;
+        ~Holder() {
+            if (index >= 0) {
+                EpochDomain::Instance().slots[index].owned.store(false, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Holder holder;
+
+    if (holder.index < 0) {
+        for (unsigned int i = 0; i < MAX_THREADS; ++i) {
+            bool expected = false;
+            if (slots[i].owned.compare_exchange_strong(expected, true)) {
+                holder.index = static_cast<int>(i);
+                break;
+            }
+        }
+        if (holder.index < 0) {
+            throw std::runtime_error("EpochDomain: too many reader threads");
+        }
+    }
+    return static_cast<unsigned int>(holder.index);
+}
+
+/* Start a read: publish the current epoch, retrying if it moved meanwhile */
+void EpochDomain::Enter() {
+    Slot& slot = slots[SlotIndex()];
+    unsigned long long epoch;
+    do {
+        epoch = globalEpoch.load();
+        slot.epoch.store(epoch + 1);
+    } while (globalEpoch.load() != epoch);
+}
+
+/* End a read */
+void EpochDomain::Exit() {
+    slots[SlotIndex()].epoch.store(0, std::memory_order_release);
+}
+
+/* Move the global epoch forward if every active reader has caught up with it */
+void EpochDomain::TryAdvance() {
+    unsigned long long epoch = globalEpoch.load();
+    for (unsigned int i = 0; i < MAX_THREADS; ++i) {
+        unsigned long long seen = slots[i].epoch.load();
+        if (seen != 0 && seen != epoch + 1) {
+            return;
+        }
+    }
+    globalEpoch.compare_exchange_strong(epoch, epoch + 1);
+}
+
+/* Hand over unlinked memory; it is freed once no reader can reach it */
+void EpochDomain::Retire(void* ptr, void (*deleter)(void*)) {
+    std::lock_guard<std::mutex> lock(retireLock);
+    retired.push_back({ ptr, deleter, globalEpoch.load() });
+    if (retired.size() < RETIRE_BATCH) {
+        return;
+    }
+
+    TryAdvance();
+    unsigned long long epoch = globalEpoch.load();
+    size_t kept = 0;
+    for (size_t i = 0; i < retired.size(); ++i) {
+        if (retired[i].epoch + 2 <= epoch) {
+            retired[i].deleter(retired[i].ptr);
+        } else {
+            retired[kept++] = retired[i];
+        }
+    }
+    retired.resize(kept);
+}
+
+/*
+    ConcurrentHashTable
+    Chained hash table that can be shared between threads. Search and
+    PrintAll take no lock: they only follow atomic links inside an epoch,
+    and a bid is never changed after its node is published. Insert and
+    Remove lock one of LOCK_STRIPES mutexes chosen by bucket, so writers to
+    different stripes run in parallel. Removed nodes are retired to the
+    EpochDomain instead of being deleted under a reader's feet. The bucket
+    count is fixed at construction.
+*/
+struct ConcurrentNode {
+    Bid bid;
+    std::atomic<ConcurrentNode*> next;
+
+    ConcurrentNode(Bid aBid) : bid(std::move(aBid)), next(nullptr) {}
+};
+
+class ConcurrentHashTable {
+private:
+    static const unsigned int DEFAULT_SIZE = 4093; // prime table size to reduce collisions
+    static const unsigned int LOCK_STRIPES = 64;
+
+    std::atomic<ConcurrentNode*>* table;
+    unsigned int tableSize;
+    std::mutex locks[LOCK_STRIPES];
+    std::atomic<unsigned int> size;
+
+    unsigned int Hash(const string& key) const;
+    static void DeleteNode(void* node);
+
+    /* Keeps the calling thread inside an epoch for its lifetime */
+    struct ReadGuard {
+        ReadGuard() { EpochDomain::Instance().Enter(); }
+        ~ReadGuard() { EpochDomain::Instance().Exit(); }
+    };
+
+public:
+    ConcurrentHashTable(unsigned int buckets = DEFAULT_SIZE);
+    virtual ~ConcurrentHashTable();
+
+    void Insert(Bid bid);
+    void PrintAll(out::Sink& sink = out::Console());
+    void Remove(string bidId);
+    Bid Search(string bidId);
+    unsigned int Size();
+};
+
+/* Constructor: initialize all buckets empty */
+ConcurrentHashTable::ConcurrentHashTable(unsigned int buckets) : size(0) {
+    tableSize = buckets == 0 ? DEFAULT_SIZE : buckets;
+    table = new std::atomic<ConcurrentNode*>[tableSize];
     for (unsigned int i = 0; i < tableSize; ++i) {
-        Node* current = table[i];
+        table[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+/* Destructor: no other thread may use the table any more */
+ConcurrentHashTable::~ConcurrentHashTable() {
+    for (unsigned int i = 0; i < tableSize; ++i) {
+        ConcurrentNode* current = table[i].load(std::memory_order_relaxed);
         while (current != nullptr) {
-            Node* next = current->next;
+            ConcurrentNode* next = current->next.load(std::memory_order_relaxed);
             delete current;
             current = next;
         }
-        table[i] = nullptr;
     }
     delete[] table;
 }
+
+/* Simple string hash function (djb2 variation) */
+unsigned int ConcurrentHashTable::Hash(const string& key) const {
+    unsigned long hash = 5381;
+    for (char c : key) {
+        hash = ((hash << 5) + hash) + c; // hash * 33 + c
+    }
+    return static_cast<unsigned int>(hash % tableSize);
+}
+
+void ConcurrentHashTable::DeleteNode(void* node) {
+    delete static_cast<ConcurrentNode*>(node);
+}
+
+/* Insert a bid at the head of its bucket */
+void ConcurrentHashTable::Insert(Bid bid) {
+    unsigned int key = Hash(bid.bidId);
+    ConcurrentNode* newNode = new ConcurrentNode(std::move(bid));
+
+    std::lock_guard<std::mutex> lock(locks[key % LOCK_STRIPES]);
+    newNode->next.store(table[key].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // release: a reader that sees the node also sees its bid and next
+    table[key].store(newNode, std::memory_order_release);
+    size.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* Display all bids (bucket order) */
+void ConcurrentHashTable::PrintAll(out::Sink& sink) {
+    ReadGuard guard;
+    for (unsigned int i = 0; i < tableSize; ++i) {
+        ConcurrentNode* current = table[i].load(std::memory_order_acquire);
+        while (current != nullptr) {
+            writeBid(sink, i, current->bid);
+            current = current->next.load(std::memory_order_acquire);
+        }
+    }
+    sink.Flush();
+}
+
+/* Remove a bid by ID */
+void ConcurrentHashTable::Remove(string bidId) {
+    unsigned int key = Hash(bidId);
+    ConcurrentNode* removed = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(locks[key % LOCK_STRIPES]);
+        std::atomic<ConcurrentNode*>* link = &table[key];
+        ConcurrentNode* current = link->load(std::memory_order_relaxed);
+
+        while (current != nullptr) {
+            if (current->bid.bidId == bidId) {
+                // readers already on this node still follow its next link
+                link->store(current->next.load(std::memory_order_relaxed), std::memory_order_release);
+                removed = current;
+                size.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            link = &current->next;
+            current = link->load(std::memory_order_relaxed);
+        }
+    }
+    if (removed != nullptr) {
+        EpochDomain::Instance().Retire(removed, DeleteNode);
+    }
+}
+
+/* Search for a bid by ID without taking a lock */
+Bid ConcurrentHashTable::Search(string bidId) {
+    unsigned int key = Hash(bidId);
+    ReadGuard guard;
+    ConcurrentNode* current = table[key].load(std::memory_order_acquire);
+
+    while (current != nullptr) {
+        if (current->bid.bidId == bidId) {
+            return current->bid;
+        }
+        current = current->next.load(std::memory_order_acquire);
+    }
+    Bid emptyBid;
+    return emptyBid; // not found
+}
+
+/* Number of bids stored */
+unsigned int ConcurrentHashTable::Size() {
+    return size.load(std::memory_order_relaxed);
+}
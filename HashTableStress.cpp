@@ -0,0 +1,188 @@
+//============================================================================
+// Name        : HashTableStress.cpp
+// Description : Multi-threaded stress and throughput check of
+//               ConcurrentHashTable (HashTable.cpp)
+//
+// Writer threads insert, replace and remove bids while reader threads
+// search the table without locks. Each writer owns the ids id % writers ==
+// its number, so the final contents do not depend on how the threads
+// interleave: once they are joined the same operations are replayed on a
+// std::map in one thread and both must hold exactly the same bids.
+// Readers check every bid they find is whole (its title starts with its
+// id), so a torn read or a node freed under a reader shows up here, or
+// under -fsanitize=thread / -fsanitize=address.
+//
+// Build (HashTable.cpp is compiled into this program):
+//   g++ -std=c++17 -O2 -pthread
+//       -I"CS-300 2-3 Assignment/CS 300 Vector Sorting Assignment Student Files"
+//       HashTableStress.cpp -o HashTableStress
+// Usage: HashTableStress [writers] [readers] [operations per writer]
+//============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct Bid {
+    std::string bidId; // unique identifier
+    std::string title;
+    std::string fund;
+    double amount;
+    Bid() : amount(0.0) {}
+};
+
+#include "HashTable.cpp"
+
+static const unsigned int KEYS_PER_WRITER = 5000;
+
+/*
+    Deterministic operation sequence of one writer. insert(bid) is called
+    for ids it does not hold and for replacements after remove(id), so the
+    same sequence works against the table and against the reference map.
+*/
+template<typename Insert, typename Remove>
+static void runWriter(unsigned int writer, unsigned int writers, unsigned int operations,
+                      Insert insert, Remove remove) {
+    mt19937 generator(writer + 1);
+    unordered_map<string, unsigned int> versions; // ids held and their last version
+
+    for (unsigned int i = 0; i < operations; ++i) {
+        string bidId = to_string((generator() % KEYS_PER_WRITER) * writers + writer);
+        auto held = versions.find(bidId);
+        if (held == versions.end()) {
+            Bid bid;
+            bid.bidId = bidId;
+            bid.title = bidId + "#0";
+            bid.fund = "Fund " + to_string(writer);
+            bid.amount = i;
+            insert(bid);
+            versions[bidId] = 0;
+        } else if (generator() % 2 == 0) {
+            remove(bidId);
+            versions.erase(held);
+        } else {
+            // replace: a reader sees either version or, briefly, none
+            remove(bidId);
+            Bid bid;
+            bid.bidId = bidId;
+            bid.title = bidId + "#" + to_string(++held->second);
+            bid.fund = "Fund " + to_string(writer);
+            bid.amount = i;
+            insert(bid);
+        }
+    }
+}
+
+/* A found bid must be the one searched for and carry its own id in the title */
+static bool wholeBid(const string& bidId, const Bid& bid) {
+    return bid.bidId == bidId
+        && bid.title.compare(0, bidId.size() + 1, bidId + "#") == 0;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int writers = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4;
+    unsigned int readers = argc > 2 ? strtoul(argv[2], nullptr, 10) : 4;
+    unsigned int operations = argc > 3 ? strtoul(argv[3], nullptr, 10) : 200000;
+    if (writers == 0) writers = 1;
+
+    ConcurrentHashTable table;
+    atomic<unsigned int> writersLeft(writers);
+    atomic<unsigned long long> lookups(0);
+    atomic<unsigned long long> hits(0);
+    atomic<bool> failed(false);
+
+    auto start = chrono::steady_clock::now();
+
+    vector<thread> threads;
+    for (unsigned int w = 0; w < writers; ++w) {
+        threads.push_back(thread([&, w]() {
+            runWriter(w, writers, operations,
+                      [&](const Bid& bid) { table.Insert(bid); },
+                      [&](const string& bidId) { table.Remove(bidId); });
+            writersLeft.fetch_sub(1);
+        }));
+    }
+    for (unsigned int r = 0; r < readers; ++r) {
+        threads.push_back(thread([&, r]() {
+            mt19937 generator(1000 + r);
+            unsigned long long done = 0;
+            unsigned long long found = 0;
+            while (writersLeft.load() != 0 && !failed.load()) {
+                string bidId = to_string(generator() % (KEYS_PER_WRITER * writers));
+                Bid bid = table.Search(bidId);
+                if (!bid.bidId.empty()) {
+                    ++found;
+                    if (!wholeBid(bidId, bid)) {
+                        cout << "FAIL: search " << bidId << " returned " << bid.bidId
+                            << " | " << bid.title << endl;
+                        failed.store(true);
+                    }
+                }
+                // the first reader also walks the whole table now and then
+                if (++done % 50000 == 0 && r == 0) {
+                    ostringstream listing;
+                    out::Sink sink(listing, out::Format::Csv);
+                    table.PrintAll(sink);
+                }
+            }
+            lookups.fetch_add(done);
+            hits.fetch_add(found);
+        }));
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // serial reference: the same operations, one writer after the other
+    map<string, Bid> reference;
+    for (unsigned int w = 0; w < writers; ++w) {
+        runWriter(w, writers, operations,
+                  [&](const Bid& bid) { reference[bid.bidId] = bid; },
+                  [&](const string& bidId) { reference.erase(bidId); });
+    }
+
+    if (table.Size() != reference.size()) {
+        cout << "FAIL: table holds " << table.Size() << " bids, reference "
+            << reference.size() << endl;
+        failed.store(true);
+    }
+    for (unsigned int k = 0; k < KEYS_PER_WRITER * writers; ++k) {
+        string bidId = to_string(k);
+        Bid bid = table.Search(bidId);
+        auto expected = reference.find(bidId);
+        if (expected == reference.end()) {
+            if (!bid.bidId.empty()) {
+                cout << "FAIL: removed bid " << bidId << " still found" << endl;
+                failed.store(true);
+            }
+        } else if (bid.bidId != bidId || bid.title != expected->second.title
+                   || bid.fund != expected->second.fund || bid.amount != expected->second.amount) {
+            cout << "FAIL: bid " << bidId << " is \"" << bid.title << "\", expected \""
+                << expected->second.title << "\"" << endl;
+            failed.store(true);
+        }
+    }
+
+    unsigned long long writes = static_cast<unsigned long long>(writers) * operations;
+    cout << writers << " writers, " << readers << " readers, " << seconds << " seconds" << endl;
+    cout << "  writes : " << writes << " (" << writes / seconds << "/s)" << endl;
+    cout << "  lookups: " << lookups.load() << " (" << lookups.load() / seconds << "/s), "
+        << hits.load() << " found" << endl;
+    cout << "  final  : " << table.Size() << " bids" << endl;
+
+    if (failed.load()) {
+        return 1;
+    }
+    cout << "ok" << endl;
+    return 0;
+}
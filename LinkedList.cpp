@@ -12,8 +12,13 @@
 #include <iomanip>
 #include <time.h>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
+#include "BidSnapshot.hpp"
 #include "CSVparser.hpp"
+#include "NodePool.hpp"
+#include "OutputSink.hpp"
 
 using namespace std;
 
@@ -28,10 +33,18 @@ struct Bid {
     Bid() : amount(0.0) {}
 };
 
+// eBid columns used to build a Bid, bound by header name
+static constexpr csv::Field<Bid> BID_SCHEMA[] = {
+    { "Auction ID|ArticleID",       [](Bid& bid, string_view v) { bid.bidId.assign(v); } },
+    { "Auction Title|ArticleTitle", [](Bid& bid, string_view v) { bid.title.assign(v); } },
+    { "Fund",                       [](Bid& bid, string_view v) { bid.fund.assign(v); } },
+    { "Winning Bid|WinningBid",     [](Bid& bid, string_view v) { bid.amount = csv::parseCurrency(v); } },
+};
+
 // Forward declarations used by main
 static Bid getBid();
 static void displayBid(const Bid& bid);
-static double strToDouble(string str, char ch);
+static void writeBid(out::Sink& sink, const Bid& bid);
 
 //============================================================================
 // Linked-List class definition
@@ -42,22 +55,39 @@ private:
     struct Node {
         Bid bid;
         Node* next;
-        Node() : next(nullptr) {}
-        Node(Bid aBid) : bid(aBid), next(nullptr) {}
+        Node* prev;     // doubly linked so an indexed node unlinks in O(1)
+        Node* nextSame; // next node with the same bidId (only with the index)
+        Node() : next(nullptr), prev(nullptr), nextSame(nullptr) {}
+        Node(Bid aBid) : bid(std::move(aBid)), next(nullptr), prev(nullptr), nextSame(nullptr) {}
+    };
+
+    // first and last node holding one bidId, chained through nextSame
+    struct IndexEntry {
+        Node* first;
+        Node* last;
     };
 
     Node* head;
     Node* tail;
     int    size;
+    NodePool<Node> pool; // storage for every node of the list
+    // bidId -> nodes, once enabled; each key views the bidId of its first
+    // node, so ids are not copied and lookups never build a string
+    unordered_map<string_view, IndexEntry> index;
+    bool indexed;
+
+    void IndexAppend(Node* node);
 
 public:
     LinkedList();
     virtual ~LinkedList();
+    void EnableIndex();
     void Append(Bid bid);
     void Prepend(Bid bid);
-    void PrintList();
+    void PrintList(out::Sink& sink = out::Console());
     void Remove(string bidId);
     Bid  Search(string bidId);
+    const Bid* Find(string_view bidId) const;
     int  Size();
 };
 
@@ -69,29 +99,54 @@ LinkedList::LinkedList() {
     head = nullptr;
     tail = nullptr;
     size = 0;
+    indexed = false;
 }
 
 /**
  * Destructor
  */
 LinkedList::~LinkedList() {
-    // Start at the head and delete each node
-    Node* cur = head;
-    while (cur != nullptr) {
-        Node* tmp = cur;
-        cur = cur->next;
-        delete tmp;
-    }
+    // the pool frees every node at once, no need to walk the list
+    pool.Clear();
+    index.clear();
     head = tail = nullptr;
     size = 0;
 }
 
+/**
+ * Keep a bidId -> node index from now on so Search, Find and Remove take
+ * constant time instead of scanning. Costs one hash entry per distinct id.
+ */
+void LinkedList::EnableIndex() {
+    if (indexed) return;
+    index.reserve(size);
+    // walk in list order so each id's chain is in list order too
+    for (Node* cur = head; cur != nullptr; cur = cur->next) {
+        cur->nextSame = nullptr;
+        IndexAppend(cur);
+    }
+    indexed = true;
+}
+
+/**
+ * Add a node that is now the last one with its bidId to the index
+ */
+void LinkedList::IndexAppend(Node* node) {
+    auto found = index.find(node->bid.bidId);
+    if (found == index.end()) {
+        index.emplace(string_view(node->bid.bidId), IndexEntry{ node, node });
+    } else {
+        found->second.last->nextSame = node;
+        found->second.last = node;
+    }
+}
+
 /**
  * Append a new bid to the end of the list
  */
 void LinkedList::Append(Bid bid) {
     // Create new node
-    Node* node = new Node(bid);
+    Node* node = pool.New(std::move(bid));
 
     // if there is nothing at the head...
     if (head == nullptr) {
@@ -100,9 +155,14 @@ void LinkedList::Append(Bid bid) {
     } else {
         // make current tail node point to the new node
         tail->next = node;
+        node->prev = tail;
         // and tail becomes the new node
         tail = node;
     }
+    // it is the last bid with its id
+    if (indexed) {
+        IndexAppend(node);
+    }
     // increase size count
     ++size;
 }
@@ -112,12 +172,13 @@ void LinkedList::Append(Bid bid) {
  */
 void LinkedList::Prepend(Bid bid) {
     // Create new node
-    Node* node = new Node(bid);
+    Node* node = pool.New(std::move(bid));
 
     // if there is already something at the head...
     if (head != nullptr) {
         // new node points to current head as its next node
         node->next = head;
+        head->prev = node;
     } else {
         // list was empty: this node is also the tail
         tail = node;
@@ -125,6 +186,20 @@ void LinkedList::Prepend(Bid bid) {
 
     // head now becomes the new node
     head = node;
+    // it is the first bid with its id
+    if (indexed) {
+        auto found = index.find(node->bid.bidId);
+        if (found == index.end()) {
+            index.emplace(string_view(node->bid.bidId), IndexEntry{ node, node });
+        } else {
+            // the key moves to the new first node's id (the map node is reused)
+            auto entry = index.extract(found);
+            node->nextSame = entry.mapped().first;
+            entry.mapped().first = node;
+            entry.key() = node->bid.bidId;
+            index.insert(std::move(entry));
+        }
+    }
     // increase size count
     ++size;
 }
@@ -132,74 +207,96 @@ void LinkedList::Prepend(Bid bid) {
 /**
  * Simple output of all bids in the list
  */
-void LinkedList::PrintList() {
+void LinkedList::PrintList(out::Sink& sink) {
     // start at the head
     Node* cur = head;
     // while current node is not equal to nullptr
     while (cur != nullptr) {
-        // output the current bid
-        displayBid(cur->bid);
+        // buffer the current bid
+        writeBid(sink, cur->bid);
         // set current to the next node
         cur = cur->next;
     }
+    // one write for the whole list
+    sink.Flush();
 }
 
 /**
  * Remove a specified bid
  */
 void LinkedList::Remove(string bidId) {
-    // if list is empty, nothing to do
-    if (head == nullptr) return;
-
-    // special case: removing the head
-    if (head->bid.bidId == bidId) {
-        Node* tmp = head;
-        head = head->next;
-        if (tmp == tail) {
-            // it was the only node
-            tail = nullptr;
+    // find the first node with this id
+    Node* cur = nullptr;
+    if (indexed) {
+        auto found = index.find(bidId);
+        // not found: nothing removed
+        if (found == index.end()) return;
+        cur = found->second.first;
+        // the next node with the same id (if any) becomes the first, and
+        // the key must stop viewing the id of the node about to be freed
+        if (cur->nextSame == nullptr) {
+            index.erase(found);
+        } else {
+            auto entry = index.extract(found);
+            entry.mapped().first = cur->nextSame;
+            entry.key() = cur->nextSame->bid.bidId;
+            index.insert(std::move(entry));
         }
-        delete tmp;
-        --size;
-        return;
+    } else {
+        cur = head;
+        while (cur != nullptr && cur->bid.bidId != bidId) {
+            cur = cur->next;
+        }
+        // not found: nothing removed
+        if (cur == nullptr) return;
     }
 
-    // otherwise, search for the node keeping track of the previous
-    Node* prev = head;
-    Node* cur  = head->next;
-    while (cur != nullptr) {
-        if (cur->bid.bidId == bidId) {
-            prev->next = cur->next;
-            if (cur == tail) {
-                tail = prev;
-            }
-            delete cur;
-            --size;
-            return;
-        }
-        prev = cur;
-        cur  = cur->next;
+    // unlink it from its neighbours
+    if (cur->prev != nullptr) {
+        cur->prev->next = cur->next;
+    } else {
+        head = cur->next;
     }
-    // not found: nothing removed
+    if (cur->next != nullptr) {
+        cur->next->prev = cur->prev;
+    } else {
+        tail = cur->prev;
+    }
+    pool.Delete(cur);
+    --size;
 }
 
 /**
- * Search for the specified bid
+ * Search for the specified bid, returning a copy
  */
 Bid LinkedList::Search(string bidId) {
+    const Bid* bid = Find(bidId);
+    // not found: return an empty bid
+    return bid != nullptr ? *bid : Bid();
+}
+
+/**
+ * Find the specified bid without copying it; nullptr if not found
+ */
+const Bid* LinkedList::Find(string_view bidId) const {
+    // with the index, the first node with this id is one lookup away
+    if (indexed) {
+        auto found = index.find(bidId);
+        return found != index.end() ? &found->second.first->bid : nullptr;
+    }
+
     // Start at the head
-    Node* cur = head;
+    const Node* cur = head;
     // keep searching until current node not equal to nullptr
     while (cur != nullptr) {
         // if the current node matches, return it
         if (cur->bid.bidId == bidId) {
-            return cur->bid;
+            return &cur->bid;
         }
         // otherwise go to the next node
         cur = cur->next;
     }
-    // not found: return an empty bid
-    return Bid();
+    return nullptr;
 }
 
 /**
@@ -209,54 +306,236 @@ int LinkedList::Size() {
     return size;
 }
 
+//============================================================================
+// Unrolled linked-list class definition
+//============================================================================
+
+/**
+ * Linked list whose nodes (chunks) each hold up to CHUNK_SIZE bids in an
+ * array, with the same interface as LinkedList. A scan reads CHUNK_SIZE
+ * bids back to back before following a pointer, so it streams through
+ * memory instead of taking a cache miss per bid. Remove closes the gap in
+ * its chunk and folds the chunk into its successor once both are sparse,
+ * keeping chunks reasonably full without ever reorganising the list.
+ */
+class UnrolledLinkedList {
+private:
+    static const int CHUNK_SIZE = 32;
+
+    struct Chunk {
+        int count;           // bids in use, bids[0..count)
+        Chunk* next;
+        Bid bids[CHUNK_SIZE];
+        Chunk() : count(0), next(nullptr) {}
+    };
+
+    Chunk* head;
+    Chunk* tail;
+    int    size;
+    NodePool<Chunk, 16> pool; // storage for every chunk of the list
+
+public:
+    UnrolledLinkedList();
+    virtual ~UnrolledLinkedList();
+    void Append(Bid bid);
+    void Prepend(Bid bid);
+    void PrintList(out::Sink& sink = out::Console());
+    void Remove(string bidId);
+    Bid  Search(string bidId);
+    const Bid* Find(string_view bidId) const;
+    int  Size();
+};
+
+/**
+ * Default constructor
+ */
+UnrolledLinkedList::UnrolledLinkedList() {
+    head = nullptr;
+    tail = nullptr;
+    size = 0;
+}
+
+/**
+ * Destructor
+ */
+UnrolledLinkedList::~UnrolledLinkedList() {
+    // the pool frees every chunk at once, no need to walk the list
+    pool.Clear();
+    head = tail = nullptr;
+    size = 0;
+}
+
+/**
+ * Append a new bid to the end of the list
+ */
+void UnrolledLinkedList::Append(Bid bid) {
+    // start a new chunk when the last one is full
+    if (tail == nullptr || tail->count == CHUNK_SIZE) {
+        Chunk* chunk = pool.New();
+        if (tail == nullptr) {
+            head = chunk;
+        } else {
+            tail->next = chunk;
+        }
+        tail = chunk;
+    }
+    tail->bids[tail->count++] = std::move(bid);
+    ++size;
+}
+
+/**
+ * Prepend a new bid to the start of the list
+ */
+void UnrolledLinkedList::Prepend(Bid bid) {
+    // start a new chunk when the first one is full
+    if (head == nullptr || head->count == CHUNK_SIZE) {
+        Chunk* chunk = pool.New();
+        chunk->next = head;
+        head = chunk;
+        if (tail == nullptr) {
+            tail = chunk;
+        }
+    }
+    // shift the chunk's bids up one slot to make room at the front
+    std::move_backward(head->bids, head->bids + head->count, head->bids + head->count + 1);
+    head->bids[0] = std::move(bid);
+    ++head->count;
+    ++size;
+}
+
+/**
+ * Simple output of all bids in the list
+ */
+void UnrolledLinkedList::PrintList(out::Sink& sink) {
+    for (const Chunk* chunk = head; chunk != nullptr; chunk = chunk->next) {
+        for (int i = 0; i < chunk->count; ++i) {
+            writeBid(sink, chunk->bids[i]);
+        }
+    }
+    // one write for the whole list
+    sink.Flush();
+}
+
+/**
+ * Remove a specified bid
+ */
+void UnrolledLinkedList::Remove(string bidId) {
+    Chunk* prev = nullptr;
+    for (Chunk* chunk = head; chunk != nullptr; prev = chunk, chunk = chunk->next) {
+        for (int i = 0; i < chunk->count; ++i) {
+            if (chunk->bids[i].bidId != bidId) continue;
+
+            // close the gap
+            std::move(chunk->bids + i + 1, chunk->bids + chunk->count, chunk->bids + i);
+            --chunk->count;
+            --size;
+
+            if (chunk->count == 0) {
+                // drop the empty chunk
+                if (prev == nullptr) {
+                    head = chunk->next;
+                } else {
+                    prev->next = chunk->next;
+                }
+                if (chunk == tail) {
+                    tail = prev;
+                }
+                pool.Delete(chunk);
+            } else if (chunk->next != nullptr
+                       && chunk->count + chunk->next->count <= CHUNK_SIZE * 3 / 4) {
+                // fold a sparse neighbour in so chunks stay reasonably full
+                Chunk* next = chunk->next;
+                std::move(next->bids, next->bids + next->count, chunk->bids + chunk->count);
+                chunk->count += next->count;
+                chunk->next = next->next;
+                if (next == tail) {
+                    tail = chunk;
+                }
+                pool.Delete(next);
+            }
+            return;
+        }
+    }
+    // not found: nothing removed
+}
+
+/**
+ * Search for the specified bid, returning a copy
+ */
+Bid UnrolledLinkedList::Search(string bidId) {
+    const Bid* bid = Find(bidId);
+    // not found: return an empty bid
+    return bid != nullptr ? *bid : Bid();
+}
+
+/**
+ * Find the specified bid without copying it; nullptr if not found
+ */
+const Bid* UnrolledLinkedList::Find(string_view bidId) const {
+    for (const Chunk* chunk = head; chunk != nullptr; chunk = chunk->next) {
+        for (int i = 0; i < chunk->count; ++i) {
+            if (chunk->bids[i].bidId == bidId) {
+                return &chunk->bids[i];
+            }
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Returns size
+ */
+int UnrolledLinkedList::Size() {
+    return size;
+}
+
 /**
- * Load bids from a CSV file into the provided list.
+ * Load bids from a CSV file into the provided list (LinkedList or
+ * UnrolledLinkedList).
  */
-void loadBids(string csvPath, LinkedList& list) {
+template<typename List>
+void loadBids(string csvPath, List& list) {
     cout << "Loading CSV file " << csvPath << endl;
 
     clock_t ticks = clock();
 
-    csv::Parser file = csv::Parser(csvPath);
+    int count = list.Size();
 
-    // Assume headers: Id, Title, Fund, Amount
-    for (unsigned int i = 0; i < file.rowCount(); ++i) {
-        Bid bid;
-        bid.bidId = file[i][0];
-        bid.title = file[i][1];
-        bid.fund  = file[i][8];   // some datasets use column 8 for Fund
-        string amountStr = file[i][4];
-        // remove $ and commas
-        bid.amount = strToDouble(amountStr, '$');
-
-        list.Append(bid);
+    // reuse the binary snapshot of a previous run if the CSV is unchanged
+    if (snapshot::Load<Bid>(csvPath, [&](Bid& bid) { list.Append(std::move(bid)); })) {
+        cout << "(from snapshot " << snapshot::pathFor(csvPath) << ")" << endl;
+    } else {
+        // stream rows so the list is built while the file is still being read
+        csv::Reader file(csvPath);
+        // resolve the Id, Title, Fund and Amount columns once by header name
+        csv::Schema<Bid> schema(BID_SCHEMA, file);
+        snapshot::Writer cache(csvPath);
+
+        while (file.next()) {
+            Bid bid;
+            schema.bind(file, bid);
+            cache.Add(bid);
+
+            list.Append(std::move(bid));
+        }
+        cache.Commit();
     }
+    count = list.Size() - count;
 
     ticks = clock() - ticks;
-    cout << file.rowCount() << " bids read" << endl;
+    cout << count << " bids read" << endl;
     cout << "time: " << ticks << " clock ticks" << endl;
     cout << "time: " << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
 }
 
 /**
- * The one and only main() method
+ * Menu loop over a list of bids; works with LinkedList and UnrolledLinkedList
  */
-int main(int argc, char* argv[]) {
-    // process command line arguments
-    string csvPath;
-    if (argc == 2) {
-        csvPath = argv[1];
-    } else {
-        // default to the larger data set; can be changed by the grader
-        csvPath = "eBid_Monthly_Sales.csv";
-    }
-
+template<typename List>
+void runMenu(const string& csvPath, List& bidList) {
     // Define a timer variable
     clock_t ticks;
 
-    // Define a LinkedList to hold all bids
-    LinkedList bidList;
-
     // Define a bid instance for user input/find results
     Bid bid;
 
@@ -289,13 +568,13 @@ int main(int argc, char* argv[]) {
                 bidList.PrintList();
                 break;
 
-            case 4:
+            case 4: {
                 ticks = clock();
-                bid = bidList.Search(bidKey);
+                const Bid* found = bidList.Find(bidKey);
                 ticks = clock() - ticks;
 
-                if (!bid.bidId.empty()) {
-                    displayBid(bid);
+                if (found != nullptr) {
+                    displayBid(*found);
                 } else {
                     cout << "Bid Id " << bidKey << " not found." << endl;
                 }
@@ -303,6 +582,7 @@ int main(int argc, char* argv[]) {
                 cout << "time: " << ticks << " clock ticks" << endl;
                 cout << "time: " << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
                 break;
+            }
 
             case 5:
                 bidList.Remove(bidKey);
@@ -316,6 +596,34 @@ int main(int argc, char* argv[]) {
                 break;
         }
     }
+}
+
+/**
+ * The one and only main() method
+ */
+int main(int argc, char* argv[]) {
+    // process command line arguments: [--unrolled] [csvPath]
+    // default to the larger data set; can be changed by the grader
+    string csvPath = "eBid_Monthly_Sales.csv";
+    bool unrolled = false;
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--unrolled") {
+            unrolled = true;
+        } else {
+            csvPath = argv[i];
+        }
+    }
+
+    if (unrolled) {
+        // bids stored in chunks: faster full scans, but Find has no index
+        UnrolledLinkedList bidList;
+        runMenu(csvPath, bidList);
+    } else {
+        // Define a LinkedList to hold all bids, indexed by id so Find stays fast
+        LinkedList bidList;
+        bidList.EnableIndex();
+        runMenu(csvPath, bidList);
+    }
 
     cout << "Good bye." << endl;
     return 0;
@@ -325,9 +633,20 @@ int main(int argc, char* argv[]) {
  * Display the bid information to the console (sample format)
  */
 void displayBid(const Bid& bid) {
-    cout << bid.bidId << ": " << bid.title << " | "
-         << fixed << setprecision(2) << bid.amount << " | "
-         << bid.fund << endl;
+    writeBid(out::Console(), bid);
+    out::Console().Flush();
+}
+
+/**
+ * Buffer one bid in the sink; text format is "id: title | amount | fund"
+ */
+void writeBid(out::Sink& sink, const Bid& bid) {
+    sink.Begin();
+    sink.Field("bidId", bid.bidId);
+    sink.Field("title", bid.title, ": ");
+    sink.Money("amount", bid.amount, " | ");
+    sink.Field("fund", bid.fund, " | ");
+    sink.End();
 }
 
 /**
@@ -349,17 +668,7 @@ Bid getBid() {
     cout << "Enter amount: ";
     string strAmount;
     getline(cin, strAmount);
-    bid.amount = strToDouble(strAmount, '$');
+    bid.amount = csv::parseCurrency(strAmount);
 
     return bid;
 }
-
-/**
- * Simple method to convert a string to a double
- * after stripping out unwanted char
- */
-double strToDouble(string str, char ch) {
-    str.erase(remove(str.begin(), str.end(), ch), str.end());
-    str.erase(remove(str.begin(), str.end(), ','), str.end());
-    return atof(str.c_str());
-}
@@ -0,0 +1,122 @@
+#ifndef     _NODEPOOL_HPP_
+# define    _NODEPOOL_HPP_
+
+/*
+    NodePool.hpp
+    Slab allocator for the node based containers (linked list, hash table
+    chains, binary search trees).
+
+    Nodes are carved out of slabs of SLAB_SIZE slots, so nodes created one
+    after another sit next to each other in memory and a container of n
+    nodes costs n / SLAB_SIZE allocations instead of n. Delete puts a slot
+    on a free list for the next New. Clear destroys every live node with a
+    linear walk over the slabs and releases the slabs, so a container can
+    drop all of its nodes without following a single link.
+*/
+
+# include <new>
+# include <type_traits>
+# include <utility>
+
+template<typename T, unsigned int SLAB_SIZE = 256>
+class NodePool {
+private:
+    struct Slot {
+        union {
+            Slot* next; // while on the free list
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+        bool live;
+    };
+
+    struct Slab {
+        Slot slots[SLAB_SIZE];
+        Slab* next;
+    };
+
+    Slab* slabs;        // newest first
+    unsigned int used;  // slots handed out from the newest slab
+    Slot* freeList;
+    unsigned int count;
+
+    NodePool(const NodePool&);
+    NodePool& operator=(const NodePool&);
+
+    Slot* Take() {
+        if (freeList != nullptr) {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            return slot;
+        }
+        if (slabs == nullptr || used == SLAB_SIZE) {
+            Slab* slab = new Slab;
+            slab->next = slabs;
+            slabs = slab;
+            used = 0;
+        }
+        return &slabs->slots[used++];
+    }
+
+public:
+    NodePool() : slabs(nullptr), used(0), freeList(nullptr), count(0) {}
+
+    ~NodePool() {
+        Clear();
+    }
+
+    /* Construct a T in a free slot */
+    template<typename... Args>
+    T* New(Args&&... args) {
+        Slot* slot = Take();
+        try {
+            new (slot->storage) T(std::forward<Args>(args)...);
+        } catch (...) {
+            slot->live = false;
+            slot->next = freeList;
+            freeList = slot;
+            throw;
+        }
+        slot->live = true;
+        ++count;
+        return reinterpret_cast<T*>(slot->storage);
+    }
+
+    /* Destroy one object and keep its slot for reuse */
+    void Delete(T* object) {
+        if (object == nullptr) return;
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        object->~T();
+        slot->live = false;
+        slot->next = freeList;
+        freeList = slot;
+        --count;
+    }
+
+    /* Destroy every live object and release all slabs */
+    void Clear() {
+        while (slabs != nullptr) {
+            Slab* slab = slabs;
+            if (!std::is_trivially_destructible<T>::value) {
+                // only the first `used` slots of the newest slab were handed out
+                for (unsigned int i = 0; i < used; ++i) {
+                    if (slab->slots[i].live) {
+                        reinterpret_cast<T*>(slab->slots[i].storage)->~T();
+                    }
+                }
+            }
+            slabs = slab->next;
+            used = SLAB_SIZE; // every older slab is full
+            delete slab;
+        }
+        used = 0;
+        freeList = nullptr;
+        count = 0;
+    }
+
+    /* Number of live objects */
+    unsigned int Size() const {
+        return count;
+    }
+};
+
+#endif /*!_NODEPOOL_HPP_*/
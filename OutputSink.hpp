@@ -0,0 +1,283 @@
+#ifndef     _OUTPUTSINK_HPP_
+# define    _OUTPUTSINK_HPP_
+
+/*
+    OutputSink.hpp
+    Buffered record writer shared by every listing (bids, courses).
+
+    Records are built field by field into one large buffer that is handed
+    to the stream only when it fills up or on Flush(), instead of one
+    flush per line with endl. The same calls produce three formats:
+        Text       : the human readable console layout, each field printed
+                     after its text prefix ("12345: title | 10.00 | fund")
+        Csv        : one comma separated row per record, quoted as needed,
+                     after a header row of the first record's field names
+        JsonLines  : one {"name":value,...} object per line
+    Money amounts are formatted from integer cents, skipping iostream
+    formatting entirely. Values are written as given: callers hand over
+    plain text (csv::Schema removes the CSV quoting when bids are loaded),
+    and each format adds its own quoting.
+
+    Console() is the sink on std::cout used by the programs; its format
+    comes from the OUTPUT_FORMAT environment variable (text, csv or json)
+    so full dumps can be piped into other tools.
+*/
+
+# include <cmath>
+# include <cstdio>
+# include <cstdlib>
+# include <algorithm>
+# include <cstring>
+# include <iostream>
+# include <string>
+# include <string_view>
+# include <vector>
+
+namespace out
+{
+    enum class Format { Text, Csv, JsonLines };
+
+    /* text, csv or json (jsonl); false and format unchanged for anything else */
+    inline bool ParseFormat(std::string_view name, Format &format)
+    {
+        if (name == "text") format = Format::Text;
+        else if (name == "csv") format = Format::Csv;
+        else if (name == "json" || name == "jsonl") format = Format::JsonLines;
+        else return false;
+        return true;
+    }
+
+    class Sink {
+    private:
+        std::ostream &os;
+        Format format;
+        std::vector<char> buffer;
+        std::size_t used;
+        bool firstField;  // no field written yet in the current record
+        bool headerPending;  // csv: the first record is buffered until its header is known
+        std::size_t recordStart;  // offset of the current record in buffer
+        std::string header;  // csv: field names of the first record
+        bool anyRecord;  // a record was ended, so it is too late for a header
+
+        Sink(const Sink&);
+        Sink& operator=(const Sink&);
+
+        void Put(const char *data, std::size_t len) {
+            if (used + len > buffer.size()) {
+                if (headerPending) {
+                    // the header goes in front of the first record: keep it all buffered
+                    buffer.resize(std::max(buffer.size() * 2, used + len));
+                } else {
+                    Flush();
+                    if (len > buffer.size()) {
+                        os.write(data, len);
+                        return;
+                    }
+                }
+            }
+            std::memcpy(buffer.data() + used, data, len);
+            used += len;
+        }
+
+        void Put(std::string_view s) {
+            Put(s.data(), s.size());
+        }
+
+        void Put(char c) {
+            if (used == buffer.size()) {
+                Put(&c, 1);
+                return;
+            }
+            buffer[used++] = c;
+        }
+
+        /* separator, key or text prefix that comes before a field's value */
+        void Key(const char *name, const char *textPrefix) {
+            switch (format) {
+                case Format::Text:
+                    Put(std::string_view(textPrefix));
+                    break;
+                case Format::Csv:
+                    if (!firstField) Put(',');
+                    if (headerPending) {
+                        if (!firstField) header.push_back(',');
+                        header.append(name);
+                    }
+                    break;
+                case Format::JsonLines:
+                    if (!firstField) Put(',');
+                    Put('"');
+                    Escaped(name);
+                    Put("\":");
+                    break;
+            }
+            firstField = false;
+        }
+
+        /* body of a JSON string */
+        void Escaped(std::string_view s) {
+            static const char HEX[] = "0123456789abcdef";
+            std::size_t start = 0;
+            for (std::size_t i = 0; i < s.size(); ++i) {
+                unsigned char c = static_cast<unsigned char>(s[i]);
+                if (c >= 0x20 && c != '"' && c != '\\') continue;
+                Put(s.data() + start, i - start);
+                if (c == '"' || c == '\\') {
+                    Put('\\');
+                    Put(static_cast<char>(c));
+                } else {
+                    char escape[6] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15] };
+                    Put(escape, sizeof(escape));
+                }
+                start = i + 1;
+            }
+            Put(s.data() + start, s.size() - start);
+        }
+
+        /* CSV field, quoted only when it contains a comma, quote or line break */
+        void Quoted(std::string_view s) {
+            if (s.find_first_of(",\"\r\n") == std::string_view::npos) {
+                Put(s);
+                return;
+            }
+            Put('"');
+            std::size_t start = 0;
+            for (std::size_t quote = s.find('"'); quote != std::string_view::npos; quote = s.find('"', start)) {
+                Put(s.data() + start, quote + 1 - start);
+                Put('"');
+                start = quote + 1;
+            }
+            Put(s.data() + start, s.size() - start);
+            Put('"');
+        }
+
+    public:
+        static const std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+        explicit Sink(std::ostream &stream = std::cout, Format fmt = Format::Text,
+                      std::size_t capacity = DEFAULT_CAPACITY)
+            : os(stream), format(fmt), buffer(capacity > 0 ? capacity : 1), used(0), firstField(true),
+              headerPending(fmt == Format::Csv), recordStart(0), anyRecord(false) {}
+
+        ~Sink() {
+            Flush();
+        }
+
+        Format GetFormat() const {
+            return format;
+        }
+
+        /* Switching to Csv before the first record still writes the header */
+        void SetFormat(Format fmt) {
+            headerPending = fmt == Format::Csv && !anyRecord;
+            if (!headerPending) header.clear();
+            format = fmt;
+        }
+
+        /* Start a record */
+        void Begin() {
+            firstField = true;
+            recordStart = used;
+            if (format == Format::JsonLines) Put('{');
+        }
+
+        /* A string field */
+        void Field(const char *name, std::string_view value, const char *textPrefix = "") {
+            Key(name, textPrefix);
+            switch (format) {
+                case Format::Text:      Put(value); break;
+                case Format::Csv:       Quoted(value); break;
+                case Format::JsonLines: Put('"'); Escaped(value); Put('"'); break;
+            }
+        }
+
+        /* An unsigned integer field */
+        void Integer(const char *name, unsigned long long value, const char *textPrefix = "") {
+            Key(name, textPrefix);
+            char digits[24];
+            char *end = digits + sizeof(digits);
+            char *p = end;
+            do {
+                *--p = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value != 0);
+            Put(p, end - p);
+        }
+
+        /* A money amount, always with two decimals */
+        void Money(const char *name, double value, const char *textPrefix = "") {
+            Key(name, textPrefix);
+            char digits[32];
+            double scaled = value * 100;
+            // exact halves may be an artifact of the multiply; let printf round those
+            if (!std::isfinite(value) || std::fabs(value) >= 1e15
+                || std::fabs(scaled - std::trunc(scaled)) == 0.5) {
+                if (format == Format::JsonLines && !std::isfinite(value)) {
+                    Put("null");
+                    return;
+                }
+                char wide[320]; // room for every digit of DBL_MAX
+                int len = std::snprintf(wide, sizeof(wide), "%.2f", value);
+                Put(wide, len);
+                return;
+            }
+
+            long long cents = std::llround(scaled);
+            unsigned long long magnitude = cents < 0 ? 0ULL - static_cast<unsigned long long>(cents) : cents;
+            char *end = digits + sizeof(digits);
+            char *p = end;
+            *--p = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+            *--p = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+            *--p = '.';
+            do {
+                *--p = static_cast<char>('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude != 0);
+            if (cents < 0) *--p = '-';
+            Put(p, end - p);
+        }
+
+        /* Finish a record with a line break (nothing is flushed) */
+        void End() {
+            if (format == Format::JsonLines) Put('}');
+            Put('\n');
+            anyRecord = true;
+            if (headerPending) {
+                header.push_back('\n');
+                buffer.insert(buffer.begin() + recordStart, header.begin(), header.end());
+                used += header.size();
+                headerPending = false;
+                std::string().swap(header);
+            }
+        }
+
+        /* Hand everything buffered to the stream and flush it */
+        void Flush() {
+            if (used > 0) {
+                os.write(buffer.data(), used);
+                used = 0;
+            }
+            os.flush();
+        }
+    };
+
+    /* Format named by the OUTPUT_FORMAT environment variable, Text if unset */
+    inline Format EnvironmentFormat()
+    {
+        Format format = Format::Text;
+        const char *name = std::getenv("OUTPUT_FORMAT");
+        if (name != nullptr) ParseFormat(name, format);
+        return format;
+    }
+
+    /* Sink on std::cout shared by the programs */
+    inline Sink& Console()
+    {
+        static Sink console(std::cout, EnvironmentFormat());
+        return console;
+    }
+}
+
+#endif /*!_OUTPUTSINK_HPP_*/
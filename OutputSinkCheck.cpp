@@ -0,0 +1,173 @@
+//============================================================================
+// Name        : OutputSinkCheck.cpp
+// Description : Round trip of bids through out::Sink (OutputSink.hpp) and
+//               csv::Parser / csv::Schema (CSVparser.cpp)
+//
+// Bids with titles that need CSV quoting (embedded quotes, commas) are
+// loaded from a CSV through csv::Schema, which must hand the titles over
+// without their CSV quoting. They are then written as CSV through out::Sink
+// and parsed back with csv::Parser: the header row must carry the field
+// names and every unquoted value must equal the original. The JSON lines
+// output must escape the quotes once.
+//
+// Build:
+//   g++ -std=c++17 -O2
+//       -I"CS-300 2-3 Assignment/CS 300 Vector Sorting Assignment Student Files"
+//       OutputSinkCheck.cpp
+//       "CS-300 2-3 Assignment/CS 300 Vector Sorting Assignment Student Files/CSVparser.cpp"
+//       -o OutputSinkCheck
+// Usage: OutputSinkCheck
+//============================================================================
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CSVparser.hpp"
+#include "OutputSink.hpp"
+
+using namespace std;
+
+struct Bid {
+    string bidId; // unique identifier
+    string title;
+    string fund;
+    double amount;
+    Bid() : amount(0.0) {}
+};
+
+static constexpr csv::Field<Bid> BID_SCHEMA[] = {
+    { "Auction ID", [](Bid& b, string_view v) { b.bidId.assign(v); } },
+    { "Auction Title", [](Bid& b, string_view v) { b.title.assign(v); } },
+    { "Fund", [](Bid& b, string_view v) { b.fund.assign(v); } },
+    { "Winning Bid", [](Bid& b, string_view v) { b.amount = csv::parseCurrency(v); } },
+};
+
+/* The same record layout the programs print bids with */
+static void writeBid(out::Sink& sink, const Bid& bid) {
+    sink.Begin();
+    sink.Field("bidId", bid.bidId);
+    sink.Field("title", bid.title, ": ");
+    sink.Money("amount", bid.amount, " | ");
+    sink.Field("fund", bid.fund, " | ");
+    sink.End();
+}
+
+static vector<Bid> expectedBids() {
+    vector<Bid> bids(3);
+    bids[0].bidId = "98001";
+    bids[0].title = "\"ASE\" File Cabinet";
+    bids[0].fund = "General Fund";
+    bids[0].amount = 1024.5;
+    bids[1].bidId = "98002";
+    bids[1].title = "Desk, oak";
+    bids[1].fund = "Enterprise";
+    bids[1].amount = 75;
+    bids[2].bidId = "98003";
+    bids[2].title = "Chair";
+    bids[2].fund = "\"Quoted\" Fund, Inc.";
+    bids[2].amount = 0.99;
+    return bids;
+}
+
+static bool sameBid(const Bid& a, const Bid& b) {
+    return a.bidId == b.bidId && a.title == b.title && a.fund == b.fund && a.amount == b.amount;
+}
+
+/* Titles loaded through csv::Schema arrive without their CSV quoting */
+static bool checkSchema(const string& path, const vector<Bid>& expected) {
+    {
+        ofstream input(path);
+        input << "Auction Title,Auction ID,Fund,Winning Bid\n"
+            << "\"\"\"ASE\"\" File Cabinet\",98001,General Fund,\"$1,024.50\"\n"
+            << "\"Desk, oak\",98002,Enterprise,$75.00\n"
+            << "Chair,98003,\"\"\"Quoted\"\" Fund, Inc.\",$0.99\n";
+    }
+    csv::Reader file(path);
+    csv::Schema<Bid> schema(BID_SCHEMA, file);
+    size_t n = 0;
+    while (file.next()) {
+        Bid bid;
+        schema.bind(file, bid);
+        if (n == expected.size() || !sameBid(bid, expected[n])) {
+            cout << "FAIL: schema row " << n << " read as " << bid.bidId << " | " << bid.title
+                << " | " << bid.fund << " | " << bid.amount << endl;
+            return false;
+        }
+        ++n;
+    }
+    if (n != expected.size()) {
+        cout << "FAIL: schema read " << n << " of " << expected.size() << " bids" << endl;
+        return false;
+    }
+    return true;
+}
+
+/* A CSV listing parses back into the header and the original values */
+static bool checkCsv(const string& path, const vector<Bid>& bids) {
+    {
+        ofstream listing(path);
+        out::Sink sink(listing, out::Format::Csv, 16); // tiny buffer: the header must survive a spill
+        for (const Bid& bid : bids) {
+            writeBid(sink, bid);
+        }
+    }
+
+    csv::Parser file(path);
+    vector<string> header = file.getHeader();
+    if (header != vector<string>{ "bidId", "title", "amount", "fund" }) {
+        cout << "FAIL: csv header is not bidId,title,amount,fund" << endl;
+        return false;
+    }
+    if (file.rowCount() != bids.size()) {
+        cout << "FAIL: csv listing has " << file.rowCount() << " rows, expected " << bids.size() << endl;
+        return false;
+    }
+    string scratch;
+    for (unsigned int n = 0; n < file.rowCount(); ++n) {
+        csv::Row row = file[n];
+        Bid bid;
+        bid.bidId.assign(csv::unquote(row[0], scratch));
+        bid.title.assign(csv::unquote(row[1], scratch));
+        bid.amount = csv::parseCurrency(csv::unquote(row[2], scratch));
+        bid.fund.assign(csv::unquote(row[3], scratch));
+        if (!sameBid(bid, bids[n])) {
+            cout << "FAIL: csv row " << n << " read back as " << bid.bidId << " | " << bid.title
+                << " | " << bid.fund << " | " << bid.amount << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Quotes are escaped exactly once in JSON lines */
+static bool checkJson(const vector<Bid>& bids) {
+    ostringstream listing;
+    {
+        out::Sink sink(listing, out::Format::JsonLines);
+        writeBid(sink, bids[0]);
+    }
+    string expected = "{\"bidId\":\"98001\",\"title\":\"\\\"ASE\\\" File Cabinet\","
+        "\"amount\":1024.50,\"fund\":\"General Fund\"}\n";
+    if (listing.str() != expected) {
+        cout << "FAIL: json line is " << listing.str();
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    string path = "OutputSinkCheck.tmp.csv";
+    vector<Bid> bids = expectedBids();
+
+    bool ok = checkSchema(path, bids) && checkCsv(path, bids) && checkJson(bids);
+    remove(path.c_str());
+    if (!ok) {
+        return 1;
+    }
+    cout << "ok" << endl;
+    return 0;
+}
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include "NodePool.hpp"
+#include "OutputSink.hpp"
 using namespace std;
 
 // Structure to hold course information
@@ -27,10 +29,11 @@ struct Node {
 class CourseBST {
 private:
     Node* root;
+    NodePool<Node> pool; // every course node, released together
 
     void addNode(Node*& node, Course course) {
         if (node == nullptr) {
-            node = new Node(course);
+            node = pool.New(course);
         } else if (course.courseNumber < node->course.courseNumber) {
             addNode(node->left, course);
         } else {
@@ -38,11 +41,14 @@ private:
         }
     }
 
-    void inOrder(Node* node) {
+    void inOrder(Node* node, out::Sink& sink) {
         if (node != nullptr) {
-            inOrder(node->left);
-            cout << node->course.courseNumber << ", " << node->course.courseName << endl;
-            inOrder(node->right);
+            inOrder(node->left, sink);
+            sink.Begin();
+            sink.Field("courseNumber", node->course.courseNumber);
+            sink.Field("courseName", node->course.courseName, ", ");
+            sink.End();
+            inOrder(node->right, sink);
         }
     }
 
@@ -55,17 +61,9 @@ private:
             return search(node->right, courseNumber);
     }
 
-    void destroy(Node* node) {
-        if (node != nullptr) {
-            destroy(node->left);
-            destroy(node->right);
-            delete node;
-        }
-    }
-
 public:
     CourseBST() : root(nullptr) {}
-    ~CourseBST() { destroy(root); }
+    ~CourseBST() { pool.Clear(); }
 
     void Insert(Course course) { addNode(root, course); }
 
@@ -75,7 +73,8 @@ public:
             return;
         }
         cout << "\nHere is a sample schedule:\n" << endl;
-        inOrder(root);
+        inOrder(root, out::Console());
+        out::Console().Flush();
         cout << endl;
     }
 
